@@ -7,6 +7,7 @@ import time
 import os
 import traceback
 import threading
+import Queue
 import math
 import platform
 
@@ -42,6 +43,13 @@ class SceneView(openglGui.glGuiPanel):
 		self._gcodeVBOs = []
 		self._gcodeFilename = None
 		self._gcodeLoadThread = None
+		self._loadID = 0
+		self._loadPending = {}
+		self._loadingMesh = None
+		self._loadingFilename = None
+		self._loadingVBO = None
+		self._lodQueue = Queue.Queue()
+		self._lodThread = None
 		self._objectShader = None
 		self._objectLoadShader = None
 		self._focusObj = None
@@ -72,7 +80,8 @@ class SceneView(openglGui.glGuiPanel):
 		# self.mirrorToolButton  = openglGui.glRadioButton(self, 10, _("Mirror"), (2,-1), group, self.OnToolSelect)
 
 		self.resetRotationButton = openglGui.glButton(self, 12, _("Reset"), (0,-2), self.OnRotateReset)
-		#self.layFlatButton       = openglGui.glButton(self, 16, _("Lay flat"), (0,-3), self.OnLayFlat)
+		self.layFlatButton       = openglGui.glButton(self, 16, _("Lay flat"), (0,-3), self.OnLayFlat)
+		self.autoOrientButton    = openglGui.glButton(self, 8, _("Auto orient"), (0,-4), self.OnAutoOrient)
 
 		self.resetScaleButton    = openglGui.glButton(self, 13, _("Reset"), (1,-2), self.OnScaleReset)
 		#self.scaleMaxButton      = openglGui.glButton(self, 17, _("To max"), (1,-3), self.OnScaleMax)
@@ -394,9 +403,10 @@ class SceneView(openglGui.glGuiPanel):
 		# elif self.mirrorToolButton.getSelected():
 			# self.tool = previewTools.toolNone(self)
 		else:
-			self.tool = previewTools.toolNone(self)
+			self.tool = previewTools.toolInfo(self)
 		self.resetRotationButton.setHidden(not self.rotateToolButton.getSelected())
-		#self.layFlatButton.setHidden(not self.rotateToolButton.getSelected())
+		self.layFlatButton.setHidden(not self.rotateToolButton.getSelected())
+		self.autoOrientButton.setHidden(not self.rotateToolButton.getSelected())
 		self.resetScaleButton.setHidden(not self.scaleToolButton.getSelected())
 		#self.scaleMaxButton.setHidden(not self.scaleToolButton.getSelected())
 		self.scaleForm.setHidden(not self.scaleToolButton.getSelected())
@@ -454,11 +464,18 @@ class SceneView(openglGui.glGuiPanel):
 	def OnLayFlat(self, button):
 		if self._selectedObj is None:
 			return
-		# self._selectedObj.layFlat()
-		# self._scene.pushFree()
-		# self._selectObject(self._selectedObj)
+		self._selectedObj.layFlat()
+		self._scene.pushFree()
+		self._selectObject(self._selectedObj)
 		# self.sceneUpdated()
 
+	def OnAutoOrient(self, button):
+		if self._selectedObj is None:
+			return
+		self._selectedObj.autoOrient()
+		self._scene.pushFree()
+		self._selectObject(self._selectedObj)
+
 	def OnScaleReset(self, button):
 		if self._selectedObj is None:
 			return
@@ -504,7 +521,6 @@ class SceneView(openglGui.glGuiPanel):
 			return
 		self._selectedObj.setScale(value, axis, self.scaleUniform.getValue())
 		self.updateProfileToControls()
-		self._scene._isCallFromScale = True
 		#self._scene._debug+=10
 		self._scene.pushFree()		
 		self._selectObject(self._selectedObj)
@@ -519,12 +535,14 @@ class SceneView(openglGui.glGuiPanel):
 			return
 		self._selectedObj.setSize(value, axis, self.scaleUniform.getValue())
 		self.updateProfileToControls()
-		self._scene._isCallFromScale = True
 		self._scene.pushFree()
 		self._selectObject(self._selectedObj)
 		# self.sceneUpdated()
 
 	def OnDeleteAll(self, e):
+		#Abort the models that are still loading, they would end up in the cleared scene otherwise.
+		self._loadID += 1
+		self._setLoadingMesh(None)
 		while len(self._scene.objects()) > 0:
 			self._deleteObject(self._scene.objects()[0])
 		self._animView = openglGui.animation(self, self._viewTarget.copy(), numpy.array([0,0,0], numpy.float32), 0.5)
@@ -540,20 +558,12 @@ class SceneView(openglGui.glGuiPanel):
 			return
 		cnt = dlg.GetValue()
 		dlg.Destroy()
-		n = 0
-		while True:
-			n += 1
-			newObj = obj.copy()
-			self._scene.add(newObj)
-			self._scene.centerAll()
-			if not self._scene.checkPlatform(newObj):
-				break
-			if n > cnt:
-				break
-		if n <= cnt:
-			self.notification.message("Could not create more then %d items" % (n - 1))
-		self._scene.remove(newObj)
-		self._scene.centerAll()
+		#All copies are added at once, and the whole platform is packed again to make room for them.
+		failed = self._scene.addArranged(map(lambda n: obj.copy(), xrange(0, cnt)))
+		for newObj in failed:
+			self._deleteObject(newObj)
+		if len(failed) > 0:
+			self.notification.message("Could not create more then %d items" % (cnt - len(failed)))
 		# self.sceneUpdated()
 
 	def OnSplitObject(self, e):
@@ -563,6 +573,7 @@ class SceneView(openglGui.glGuiPanel):
 		for obj in self._focusObj.split(self._splitCallback):
 			if numpy.max(obj.getSize()) > 2.0:
 				self._scene.add(obj)
+				self._buildLevelsOfDetail(obj)
 		self._scene.centerAll()
 		self._selectObject(None)
 		# self.sceneUpdated()
@@ -571,6 +582,8 @@ class SceneView(openglGui.glGuiPanel):
 		if self._focusObj is None:
 			return
 		self._focusObj.setPosition(numpy.array([0.0, 0.0]))
+		if self._focusObj._schematic is True:
+			self._scene.attachSchematic(self._focusObj)
 		self._scene.pushFree()
 		if self._focusObj._schematic is True:
 			newViewPos = numpy.array([self._focusObj.getPosition()[0], self._focusObj.getPosition()[1], -self._focusObj.getDrawOffset()[2]])
@@ -655,29 +668,111 @@ class SceneView(openglGui.glGuiPanel):
 		return False
 
 	def loadScene(self, fileList):
+		#Images are converted with a dialog, the model files are loaded in a background thread.
+		# The mesh that is being loaded is drawn while loading, and the objects are added to the scene when they are done.
+		meshFileList = []
 		for filename in fileList:
-			try:
-				ext = os.path.splitext(filename)[1].lower()
-				if ext in imageToMesh.supportedExtensions():
+			ext = os.path.splitext(filename)[1].lower()
+			if ext in imageToMesh.supportedExtensions():
+				try:
 					imageToMesh.convertImageDialog(self, filename).Show()
-					objList = []
-				else:
-					objList = meshLoader.loadMeshes(filename)
-			except:
-				traceback.print_exc()
+				except:
+					traceback.print_exc()
 			else:
-				for obj in objList:
-					# if self._objectLoadShader is not None:
-					# 	obj._loadAnim = openglGui.animation(self, 1, 0, 1.5)
-					# else:
-					obj._loadAnim = None
-					self._scene.add(obj)
-					self._scene.centerAll()
-					self._selectObject(obj)
-					if obj.getScale()[0] < 1.0:
-						self.notification.message("Warning: Object scaled down.")
+				meshFileList.append(filename)
+		if len(meshFileList) < 1:
+			return
+		#A new drop cancels the files that are still loading from an earlier drop, their callbacks see the changed load ID and abort.
+		self._loadID += 1
+		self._setLoadingMesh(None)
+		#The files are loaded by a pool of worker threads, adding the objects to the scene is done on the GUI thread.
+		# Only the file reading overlaps between the workers, see loadMeshesThreaded.
+		loadID = self._loadID
+		self._loadPending = {loadID: len(meshFileList)}
+		wx.CallAfter(self.notification.updateMessage, "Loading %d file(s)..." % (len(meshFileList)))
+		meshLoader.loadMeshesThreaded(meshFileList, lambda filename, objList: self._loadSceneResult(loadID, filename, objList), lambda filename, progress, m: self._loadSceneCallback(loadID, filename, progress, m))
+
+	def _loadSceneCallback(self, loadID, filename, progress, m):
+		if loadID != self._loadID:
+			return True
+		if m is not None:
+			wx.CallAfter(self._setLoadingFile, loadID, filename, m)
+		wx.CallAfter(self.notification.updateMessage, "Loading %s... %d%%" % (os.path.basename(filename), int(progress * 100)))
+		self._queueRefresh()
+		return False
+
+	def _setLoadingFile(self, loadID, filename, m):
+		#The loading mesh is drawn by the GUI thread, so it is only changed on the GUI thread.
+		if loadID != self._loadID:
+			return
+		self._loadingMesh = m
+		self._loadingFilename = filename
+
+	def _loadSceneResult(self, loadID, filename, objList):
+		#Called from the loader threads, so the orientation of new objects is optimized before they go to the GUI thread.
+		#An object that fails to orient is added as it is, the load itself goes on.
+		if loadID == self._loadID and profile.getPreference('auto_orient') == 'True':
+			for obj in objList:
+				try:
+					obj.autoOrient()
+				except:
+					traceback.print_exc()
+		wx.CallAfter(self._addLoadedObjects, filename, objList, loadID)
+
+	def _addLoadedObjects(self, filename, objList, loadID):
+		#The results of a cancelled load are dropped, the loading mesh then belongs to the newer load.
+		if loadID != self._loadID:
+			return
+		#Other files can still be loading, only stop drawing the loading mesh when it belongs to this file.
+		if self._loadingFilename == filename:
+			self._setLoadingMesh(None)
+		#The loading notification stays until the last file of this drop is done.
+		self._loadPending[loadID] -= 1
+		if self._loadPending[loadID] < 1:
+			del self._loadPending[loadID]
+			self.notification.onClose(None)
+		for obj in objList:
+			# if self._objectLoadShader is not None:
+			# 	obj._loadAnim = openglGui.animation(self, 1, 0, 1.5)
+			# else:
+			obj._loadAnim = None
+			self._scene.add(obj)
+			self._scene.centerAll()
+			self._selectObject(obj)
+			self._buildLevelsOfDetail(obj)
+			if obj.getScale()[0] < 1.0:
+				self.notification.message("Warning: Object scaled down.")
+		self._queueRefresh()
 		# self.sceneUpdated()
 
+	def _setLoadingMesh(self, m):
+		self._loadingMesh = m
+		if self._loadingVBO is not None:
+			self.glReleaseList.append(self._loadingVBO)
+			self._loadingVBO = None
+
+	def _renderLoadingMesh(self):
+		#Draw the part of the mesh that the loader has filled in so far, standing on the center of the platform.
+		# The loader thread is still writing to the vertex array, only the vertexes before vertexCount are complete.
+		m = self._loadingMesh
+		if m is None or m.isIndexed():
+			return
+		if self._loadingVBO is not None and self._loadingVBO._vertexArray is not m.vertexes:
+			self.glReleaseList.append(self._loadingVBO)
+			self._loadingVBO = None
+		if self._loadingVBO is None:
+			self._loadingVBO = opengl.GLStreamVBO(m.vertexes)
+		self._loadingVBO.setSize(m.vertexCount)
+		if self._loadingVBO.getSize() < 3:
+			return
+		vMin = self._loadingVBO.getMin()
+		vMax = self._loadingVBO.getMax()
+		glPushMatrix()
+		glTranslate(-(vMin[0] + vMax[0]) / 2, -(vMin[1] + vMax[1]) / 2, -vMin[2])
+		glColor4f(0.2, 0.6, 1.0, 0.5)
+		self._loadingVBO.render()
+		glPopMatrix()
+
 	def _deleteObject(self, obj):
 		if obj == self._selectedObj:
 			self._selectObject(None)
@@ -687,6 +782,9 @@ class SceneView(openglGui.glGuiPanel):
 		for m in obj._meshList:
 			if m.vbo is not None and m.vbo.decRef():
 				self.glReleaseList.append(m.vbo)
+			for vbo in m.lodVboList:
+				self.glReleaseList.append(vbo)
+			m.lodVboList = []
 		import gc
 		gc.collect()
 		# self.sceneUpdated()
@@ -824,7 +922,8 @@ class SceneView(openglGui.glGuiPanel):
 					menu.Destroy()
 		elif self._mouseState == 'dragObject' and self._selectedObj is not None:
 			#self._scene._debug+=1
-			self._scene._isCallFromScale = False
+			if self._selectedObj.getSchematic() is True:
+				self._scene.attachSchematic(self._selectedObj)
 			self._scene.pushFree()
 			# self.sceneUpdated()
 		elif self._mouseState == 'tool':
@@ -836,6 +935,8 @@ class SceneView(openglGui.glGuiPanel):
 			self.tool.OnDragEnd()
 			# self.sceneUpdated()
 		self._mouseState = None
+		#The level of detail depends on dragging, so draw again with the full detail.
+		self._queueRefresh()
 
 	def OnMouseMotion(self,e):
 		p0, p1 = self.getMouseRay(e.GetX(), e.GetY())
@@ -966,48 +1067,53 @@ class SceneView(openglGui.glGuiPanel):
 				pass
 		if self._objectShader is None:
 			if opengl.hasShaderSupport():
+				#The meshes are drawn with shared vertexes, so the object shaders calculate the flat face normal from the
+				# screen space derivatives of the position instead of using per vertex normals.
 				self._objectShader = opengl.GLShader("""
-varying float light_amount;
+varying vec3 eye_position;
 
 void main(void)
 {
     gl_Position = gl_ModelViewProjectionMatrix * gl_Vertex;
     gl_FrontColor = gl_Color;
 
-	light_amount = abs(dot(normalize(gl_NormalMatrix * gl_Normal), normalize(gl_LightSource[0].position.xyz)));
-	light_amount += 0.2;
+	eye_position = (gl_ModelViewMatrix * gl_Vertex).xyz;
 }
 				""","""
-varying float light_amount;
+varying vec3 eye_position;
 
 void main(void)
 {
+	vec3 normal = normalize(cross(dFdx(eye_position), dFdy(eye_position)));
+	float light_amount = abs(dot(normal, normalize(gl_LightSource[0].position.xyz)));
+	light_amount += 0.2;
 	gl_FragColor = vec4(gl_Color.xyz * light_amount, gl_Color[3]);
 }
 				""")
 				self._objectOverhangShader = opengl.GLShader("""
-uniform float cosAngle;
 uniform mat3 rotMatrix;
-varying float light_amount;
+varying vec3 eye_position;
+varying vec3 rot_position;
 
 void main(void)
 {
     gl_Position = gl_ModelViewProjectionMatrix * gl_Vertex;
     gl_FrontColor = gl_Color;
 
-	light_amount = abs(dot(normalize(gl_NormalMatrix * gl_Normal), normalize(gl_LightSource[0].position.xyz)));
-	light_amount += 0.2;
-	if (normalize(rotMatrix * gl_Normal).z < -cosAngle)
-	{
-		light_amount = -10.0;
-	}
+	eye_position = (gl_ModelViewMatrix * gl_Vertex).xyz;
+	rot_position = rotMatrix * gl_Vertex.xyz;
 }
 				""","""
-varying float light_amount;
+uniform float cosAngle;
+varying vec3 eye_position;
+varying vec3 rot_position;
 
 void main(void)
 {
-	if (light_amount == -10.0)
+	vec3 normal = normalize(cross(dFdx(eye_position), dFdy(eye_position)));
+	float light_amount = abs(dot(normal, normalize(gl_LightSource[0].position.xyz)));
+	light_amount += 0.2;
+	if (normalize(cross(dFdx(rot_position), dFdy(rot_position))).z < -cosAngle)
 	{
 		gl_FragColor = vec4(1.0, 0.0, 0.0, gl_Color[3]);
 	}else{
@@ -1243,6 +1349,7 @@ void main(void)
 			# 		self._renderObject(obj)
 			# 	self._objectLoadShader.unbind()
 			# 	glDisable(GL_BLEND)
+			self._renderLoadingMesh()
 		#serch color yello octo
 		self._drawMachine()
 
@@ -1322,6 +1429,56 @@ void main(void)
 			opengl.glDrawStringCenter(_("Overhang view not working due to lack of OpenGL shaders support."))
 			glPopMatrix()
 
+	def _getMeshVBO(self, obj, m):
+		useShader = isinstance(self._objectShader, opengl.GLShader)
+		if m.vbo is None:
+			if m.isIndexed() and useShader:
+				m.vbo = opengl.GLVBO(m.indexedVertexes, None, m.indexes)
+			else:
+				#The fixed function lighting needs a normal for each vertex, so it draws the triangle soup with the face normals.
+				m.vbo = opengl.GLVBO(m.vertexes, m.getFaceNormals())
+		if not useShader or len(m.levelsOfDetail) < 1:
+			return m.vbo
+		if len(m.lodVboList) != len(m.levelsOfDetail):
+			for vbo in m.lodVboList:
+				self.glReleaseList.append(vbo)
+			m.lodVboList = map(lambda level: opengl.GLVBO(level[0], None, level[1]), m.levelsOfDetail)
+
+		#Pick the simplest level that still has about 2 faces for each pixel the object covers on screen,
+		# the size on screen follows from the boundary circle and the distance of the camera. While dragging a lower level is fine.
+		height = self.GetSize().GetHeight()
+		radius = obj.getBoundaryCircle() * height / 2 / (math.tan(math.radians(45.0 / 2)) * max(self._zoom, 1.0))
+		faceBudget = radius * radius * 2
+		if self._mouseState in ['drag', 'dragObject', 'tool']:
+			faceBudget /= 4
+		vbo = m.vbo
+		for n in xrange(0, len(m.levelsOfDetail)):
+			if len(m.levelsOfDetail[n][1]) / 3 < faceBudget:
+				break
+			vbo = m.lodVboList[n]
+		return vbo
+
+	def _buildLevelsOfDetail(self, obj):
+		#The simplified meshes for drawing are made in the background, the full meshes are drawn until they are done.
+		# A single worker thread handles the objects one by one, so a large drop does not start a thread for each object.
+		self._lodQueue.put(obj)
+		if self._lodThread is None:
+			self._lodThread = threading.Thread(target=self._lodWorker)
+			self._lodThread.daemon = True
+			self._lodThread.start()
+
+	def _lodWorker(self):
+		while True:
+			obj = self._lodQueue.get()
+			if obj not in self._scene.objects():
+				continue
+			try:
+				obj.buildLevelsOfDetail()
+			except:
+				traceback.print_exc()
+				wx.CallAfter(self.notification.message, "Warning: Could not simplify %s, the full mesh is drawn." % (obj.getName()))
+			self._queueRefresh()
+
 	def _renderObject(self, obj, brightness = False, addSink = True):
 		glPushMatrix()
 		if addSink:
@@ -1341,12 +1498,11 @@ void main(void)
 
 		n = 0
 		for m in obj._meshList:
-			if m.vbo is None:
-				m.vbo = opengl.GLVBO(m.vertexes, m.normal)
+			vbo = self._getMeshVBO(obj, m)
 			if brightness:
 				glColor4fv(map(lambda n: n * brightness, self._objColors[n]))
 				n += 1
-			m.vbo.render()
+			vbo.render()
 
 		# #for debug
 		# glColor3f(0,0,0)
@@ -1548,6 +1704,21 @@ void main(void)
 			return [0.0, 0.0, 0.0]
 		return self._selectedObj.getSize()
 
+	def getObjectVolume(self):
+		if self._selectedObj is None:
+			return 0.0
+		return self._selectedObj.getVolume()
+
+	def getObjectSurfaceArea(self):
+		if self._selectedObj is None:
+			return 0.0
+		return self._selectedObj.getSurfaceArea()
+
+	def getObjectQuality(self):
+		if self._selectedObj is None:
+			return None
+		return self._selectedObj.getQuality()
+
 	def getObjectMatrix(self):
 		if self._selectedObj is None:
 			return numpy.matrix([[1.0, 0.0, 0.0], [0.0, 1.0, 0.0], [0.0, 0.0, 1.0]])
@@ -130,33 +130,57 @@ class GLFakeShader(GLReferenceCounter):
 	def getFragmentShader(self):
 		return ''
 
+#Write the vertexes and normals (per vertex or per face) into a single array with 6 floats per vertex.
+def _interleaveNormals(vertexArray, normalArray):
+	count = len(vertexArray)
+	data = numpy.empty((count, 6), numpy.float32)
+	data[::,0:3] = vertexArray
+	if count > 0 and len(normalArray) * 3 == count:
+		data.reshape((count / 3, 3, 6))[::,::,3:6] = numpy.asarray(normalArray).reshape((len(normalArray), 1, 3))
+	else:
+		data[::,3:6] = normalArray
+	return data
+
+#A VBO for a vertex array, with optional normals. When an index array is given the vertexes are drawn with glDrawElements,
+# so meshes with shared vertexes only need to upload every vertex once.
 class GLVBO(GLReferenceCounter):
-	def __init__(self, vertexArray, normalArray = None):
+	def __init__(self, vertexArray, normalArray = None, indexArray = None):
 		super(GLVBO, self).__init__()
+		self._indexBuffer = None
+		if indexArray is not None:
+			indexArray = numpy.asarray(indexArray, numpy.uint32)
+			self._size = len(indexArray)
+		else:
+			self._size = len(vertexArray)
+		self._hasNormals = normalArray is not None
+		if self._hasNormals:
+			vertexArray = _interleaveNormals(vertexArray, normalArray)
 		if not bool(glGenBuffers):
 			self._vertexArray = vertexArray
-			self._normalArray = normalArray
-			self._size = len(vertexArray)
+			self._indexArray = indexArray
 			self._buffer = None
-			self._hasNormals = self._normalArray is not None
 		else:
 			self._buffer = glGenBuffers(1)
-			self._size = len(vertexArray)
-			self._hasNormals = normalArray is not None
+			self._vertexArray = None
+			self._indexArray = None
 			glBindBuffer(GL_ARRAY_BUFFER, self._buffer)
-			if self._hasNormals:
-				glBufferData(GL_ARRAY_BUFFER, numpy.concatenate((vertexArray, normalArray), 1), GL_STATIC_DRAW)
-			else:
-				glBufferData(GL_ARRAY_BUFFER, vertexArray, GL_STATIC_DRAW)
+			glBufferData(GL_ARRAY_BUFFER, vertexArray, GL_STATIC_DRAW)
 			glBindBuffer(GL_ARRAY_BUFFER, 0)
+			if indexArray is not None:
+				self._indexBuffer = glGenBuffers(1)
+				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, self._indexBuffer)
+				glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexArray, GL_STATIC_DRAW)
+				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0)
 
 	def render(self, render_type = GL_TRIANGLES):
 		glEnableClientState(GL_VERTEX_ARRAY)
 		if self._buffer is None:
-			glVertexPointer(3, GL_FLOAT, 0, self._vertexArray)
 			if self._hasNormals:
 				glEnableClientState(GL_NORMAL_ARRAY)
-				glNormalPointer(GL_FLOAT, 0, self._normalArray)
+				glVertexPointer(3, GL_FLOAT, 2*3*4, c_void_p(self._vertexArray.ctypes.data))
+				glNormalPointer(GL_FLOAT, 2*3*4, c_void_p(self._vertexArray.ctypes.data + 3 * 4))
+			else:
+				glVertexPointer(3, GL_FLOAT, 0, self._vertexArray)
 		else:
 			glBindBuffer(GL_ARRAY_BUFFER, self._buffer)
 			if self._hasNormals:
@@ -170,9 +194,20 @@ class GLVBO(GLReferenceCounter):
 		extraStartPos = int(self._size / batchSize) * batchSize
 		extraCount = self._size - extraStartPos
 
-		for i in xrange(0, int(self._size / batchSize)):
-			glDrawArrays(render_type, i * batchSize, batchSize)
-		glDrawArrays(render_type, extraStartPos, extraCount)
+		if self._indexBuffer is not None:
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, self._indexBuffer)
+			for i in xrange(0, int(self._size / batchSize)):
+				glDrawElements(render_type, batchSize, GL_UNSIGNED_INT, c_void_p(i * batchSize * 4))
+			glDrawElements(render_type, extraCount, GL_UNSIGNED_INT, c_void_p(extraStartPos * 4))
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0)
+		elif self._indexArray is not None:
+			for i in xrange(0, int(self._size / batchSize)):
+				glDrawElements(render_type, batchSize, GL_UNSIGNED_INT, self._indexArray[i * batchSize:(i + 1) * batchSize])
+			glDrawElements(render_type, extraCount, GL_UNSIGNED_INT, self._indexArray[extraStartPos:])
+		else:
+			for i in xrange(0, int(self._size / batchSize)):
+				glDrawArrays(render_type, i * batchSize, batchSize)
+			glDrawArrays(render_type, extraStartPos, extraCount)
 		if self._buffer is not None:
 			glBindBuffer(GL_ARRAY_BUFFER, 0)
 
@@ -187,16 +222,74 @@ class GLVBO(GLReferenceCounter):
 			glBindBuffer(GL_ARRAY_BUFFER, 0)
 			glDeleteBuffers(1, [self._buffer])
 			self._buffer = None
+		if self._indexBuffer is not None:
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, self._indexBuffer)
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, None, GL_STATIC_DRAW)
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0)
+			glDeleteBuffers(1, [self._indexBuffer])
+			self._indexBuffer = None
 		self._vertexArray = None
-		self._normalArray = None
+		self._indexArray = None
 
 	def __del__(self):
 		if self._buffer is not None and bool(glDeleteBuffers):
 			print "VBO was not properly released!"
 
-def glDrawStringCenter(s):
+#A VBO for a vertex array that is still being filled, like a mesh that is being loaded.
+# The buffer is allocated for the whole array up front, and setSize only uploads the part that was added since the last call.
+class GLStreamVBO(GLVBO):
+	def __init__(self, vertexArray):
+		GLReferenceCounter.__init__(self)
+		self._vertexArray = vertexArray
+		self._indexArray = None
+		self._indexBuffer = None
+		self._hasNormals = False
+		self._size = 0
+		self._min = None
+		self._max = None
+		if not bool(glGenBuffers):
+			self._buffer = None
+		else:
+			self._buffer = glGenBuffers(1)
+			glBindBuffer(GL_ARRAY_BUFFER, self._buffer)
+			glBufferData(GL_ARRAY_BUFFER, vertexArray.nbytes, None, GL_STREAM_DRAW)
+			glBindBuffer(GL_ARRAY_BUFFER, 0)
+
+	def setSize(self, size):
+		size = min(size, len(self._vertexArray))
+		if size <= self._size:
+			return
+		part = self._vertexArray[self._size:size]
+		if self._min is None:
+			self._min = numpy.min(part, 0)
+			self._max = numpy.max(part, 0)
+		else:
+			self._min = numpy.minimum(self._min, numpy.min(part, 0))
+			self._max = numpy.maximum(self._max, numpy.max(part, 0))
+		if self._buffer is not None:
+			glBindBuffer(GL_ARRAY_BUFFER, self._buffer)
+			glBufferSubData(GL_ARRAY_BUFFER, self._size * 3 * 4, numpy.ascontiguousarray(part, numpy.float32))
+			glBindBuffer(GL_ARRAY_BUFFER, 0)
+		self._size = size
+
+	def getSize(self):
+		return self._size
+
+	def getMin(self):
+		return self._min
+
+	def getMax(self):
+		return self._max
+
+	def render(self, render_type = GL_TRIANGLES):
+		#Without VBO support the vertex array is used directly, in both cases only the first _size vertexes are drawn.
+		if self._size >= 3:
+			super(GLStreamVBO, self).render(render_type)
+
+def glDrawStringCenter(s, line = 0):
+	#The line moves the text down by whole lines, for text below an earlier string at the same position.
 	glRasterPos2f(0, 0)
-	glBitmap(0,0,0,0, -glGetStringSize(s)[0]/2, 0, None)
+	glBitmap(0,0,0,0, -glGetStringSize(s)[0]/2, -20 * line, None)
 	for c in s:
 		glutBitmapCharacter(OpenGL.GLUT.GLUT_BITMAP_HELVETICA_18, ord(c))
 
@@ -456,15 +549,28 @@ def DrawBox(vMin, vMax):
 	glEnd()
 
 
+def _drawElementsBatched(indexes):
+	#Odd, drawing in batchs is a LOT faster then drawing it all at once.
+	batchSize = 999    #Warning, batchSize needs to be dividable by 3
+	for i in xrange(0, len(indexes), batchSize):
+		glDrawElements(GL_TRIANGLES, len(indexes[i:i + batchSize]), GL_UNSIGNED_INT, numpy.asarray(indexes[i:i + batchSize], numpy.uint32))
+
+def _indexedArrays(m):
+	#The unique vertexes and the (intp) triangle indexes of a mesh, so the triangle soup is never build for drawing.
+	if not m.isIndexed():
+		m._buildIndexed()
+	return m.indexedVertexes, m.indexes[0:m.vertexCount - m.vertexCount % 3]
+
 def DrawMeshOutline(mesh):
 	glEnable(GL_CULL_FACE)
 	glEnableClientState(GL_VERTEX_ARRAY);
-	glVertexPointer(3, GL_FLOAT, 0, mesh.vertexes)
+	vertexes, indexes = _indexedArrays(mesh)
+	glVertexPointer(3, GL_FLOAT, 0, vertexes)
 
 	glCullFace(GL_FRONT)
 	glLineWidth(3)
 	glPolygonMode(GL_BACK, GL_LINE)
-	glDrawArrays(GL_TRIANGLES, 0, mesh.vertexCount)
+	_drawElementsBatched(indexes)
 	glPolygonMode(GL_BACK, GL_FILL)
 	glCullFace(GL_BACK)
 
@@ -476,11 +582,13 @@ def DrawMesh(mesh, insideOut = False):
 	glEnableClientState(GL_VERTEX_ARRAY)
 	glEnableClientState(GL_NORMAL_ARRAY)
 	for m in mesh._meshList:
-		glVertexPointer(3, GL_FLOAT, 0, m.vertexes)
+		#The vertexes and normals are interleaved in one array, the back faces are drawn with the normals negated in place.
+		# The fixed function lighting needs the face normals on every vertex, so this draws the triangle soup.
+		data = _interleaveNormals(m.vertexes, m.getFaceNormals())
 		if insideOut:
-			glNormalPointer(GL_FLOAT, 0, m.invNormal)
-		else:
-			glNormalPointer(GL_FLOAT, 0, m.normal)
+			data[::,3:6] *= -1
+		glVertexPointer(3, GL_FLOAT, 2*3*4, c_void_p(data.ctypes.data))
+		glNormalPointer(GL_FLOAT, 2*3*4, c_void_p(data.ctypes.data + 3 * 4))
 
 		#Odd, drawing in batchs is a LOT faster then drawing it all at once.
 		batchSize = 999    #Warning, batchSize needs to be dividable by 3
@@ -493,14 +601,9 @@ def DrawMesh(mesh, insideOut = False):
 		glDrawArrays(GL_TRIANGLES, extraStartPos, extraCount)
 
 		glCullFace(GL_FRONT)
-		if insideOut:
-			glNormalPointer(GL_FLOAT, 0, m.normal)
-		else:
-			glNormalPointer(GL_FLOAT, 0, m.invNormal)
+		data[::,3:6] *= -1
 		for i in xrange(0, int(m.vertexCount / batchSize)):
 			glDrawArrays(GL_TRIANGLES, i * batchSize, batchSize)
-		extraStartPos = int(m.vertexCount / batchSize) * batchSize
-		extraCount = m.vertexCount - extraStartPos
 		glDrawArrays(GL_TRIANGLES, extraStartPos, extraCount)
 		glCullFace(GL_BACK)
 
@@ -512,38 +615,27 @@ def DrawMeshSteep(mesh, matrix, angle):
 	cosAngle = math.sin(angle / 180.0 * math.pi)
 	glDisable(GL_LIGHTING)
 	glDepthFunc(GL_EQUAL)
-	normals = (numpy.matrix(mesh.normal, copy = False) * matrix).getA()
-	for i in xrange(0, int(mesh.vertexCount), 3):
-		if normals[i][2] < -0.999999:
-			if mesh.vertexes[i + 0][2] > 0.01:
-				glColor3f(0.5, 0, 0)
-				glBegin(GL_TRIANGLES)
-				glVertex3f(mesh.vertexes[i + 0][0], mesh.vertexes[i + 0][1], mesh.vertexes[i + 0][2])
-				glVertex3f(mesh.vertexes[i + 1][0], mesh.vertexes[i + 1][1], mesh.vertexes[i + 1][2])
-				glVertex3f(mesh.vertexes[i + 2][0], mesh.vertexes[i + 2][1], mesh.vertexes[i + 2][2])
-				glEnd()
-		elif normals[i][2] < -cosAngle:
-			glColor3f(-normals[i][2], 0, 0)
-			glBegin(GL_TRIANGLES)
-			glVertex3f(mesh.vertexes[i + 0][0], mesh.vertexes[i + 0][1], mesh.vertexes[i + 0][2])
-			glVertex3f(mesh.vertexes[i + 1][0], mesh.vertexes[i + 1][1], mesh.vertexes[i + 1][2])
-			glVertex3f(mesh.vertexes[i + 2][0], mesh.vertexes[i + 2][1], mesh.vertexes[i + 2][2])
-			glEnd()
-		elif normals[i][2] > 0.999999:
-			if mesh.vertexes[i + 0][2] > 0.01:
-				glColor3f(0.5, 0, 0)
-				glBegin(GL_TRIANGLES)
-				glVertex3f(mesh.vertexes[i + 0][0], mesh.vertexes[i + 0][1], mesh.vertexes[i + 0][2])
-				glVertex3f(mesh.vertexes[i + 2][0], mesh.vertexes[i + 2][1], mesh.vertexes[i + 2][2])
-				glVertex3f(mesh.vertexes[i + 1][0], mesh.vertexes[i + 1][1], mesh.vertexes[i + 1][2])
-				glEnd()
-		elif normals[i][2] > cosAngle:
-			glColor3f(normals[i][2], 0, 0)
-			glBegin(GL_TRIANGLES)
-			glVertex3f(mesh.vertexes[i + 0][0], mesh.vertexes[i + 0][1], mesh.vertexes[i + 0][2])
-			glVertex3f(mesh.vertexes[i + 2][0], mesh.vertexes[i + 2][1], mesh.vertexes[i + 2][2])
-			glVertex3f(mesh.vertexes[i + 1][0], mesh.vertexes[i + 1][1], mesh.vertexes[i + 1][2])
-			glEnd()
+	normals = (numpy.matrix(mesh.getFaceNormals(), copy = False) * matrix).getA()
+	vertexes, indexes = _indexedArrays(mesh)
+	faces = indexes.reshape((len(indexes) / 3, 3))
+	#Only the faces that get a color are visited, the others are skipped with a single test on all faces.
+	firstZ = vertexes[faces[::,0], 2]
+	steep = ((numpy.abs(normals[::,2]) > 0.999999) & (firstZ > 0.01)) | ((numpy.abs(normals[::,2]) > cosAngle) & (numpy.abs(normals[::,2]) <= 0.999999))
+	for i in numpy.nonzero(steep)[0]:
+		normalZ = normals[i][2]
+		if abs(normalZ) > 0.999999:
+			glColor3f(0.5, 0, 0)
+		else:
+			glColor3f(abs(normalZ), 0, 0)
+		#The faces that point up are drawn the other way around.
+		if normalZ < 0:
+			order = faces[i]
+		else:
+			order = faces[i][::-1]
+		glBegin(GL_TRIANGLES)
+		for index in order:
+			glVertex3f(vertexes[index][0], vertexes[index][1], vertexes[index][2])
+		glEnd()
 	glDepthFunc(GL_LESS)
 
 def DrawGCodeLayer(layer, drawQuick = True):
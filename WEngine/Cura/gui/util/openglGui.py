@@ -736,6 +736,15 @@ class glNotification(glFrame):
 		self._base._queueRefresh()
 		self.updateLayout()
 
+	def updateMessage(self, text):
+		#Change the text of a visible notification without restarting the slide in animation, used for progress messages.
+		if self._hidden or self._anim is None or self._anim._end < 0:
+			self.message(text)
+			return
+		self._label.setLabel(text)
+		self._base._queueRefresh()
+		self.updateLayout()
+
 	def onEject(self, button):
 		self.onClose(button)
 		self._ejectCallback()
@@ -31,6 +31,31 @@ class toolNone(object):
 	def OnDraw(self):
 		pass
 
+def _qualityText(quality):
+	#Describe the problems found by the mesh analysis, together with the "Fix horrible" options that deal with them.
+	problems = []
+	fixes = []
+	if quality['boundaryEdges'] > 0:
+		problems.append(_("%d open edges") % (quality['boundaryEdges']))
+		fixes.append(_("Extensive stitching"))
+		fixes.append(_("Keep open faces"))
+	if quality['nonManifoldEdges'] > 0:
+		problems.append(_("%d non-manifold edges") % (quality['nonManifoldEdges']))
+		fixes.append(_("Combine everything (Type-A)"))
+	if quality['flippedFaces'] > 0:
+		problems.append(_("%d flipped faces") % (quality['flippedFaces']))
+		fixes.append(_("Combine everything (Type-B)"))
+	if quality['degenerateFaces'] > 0:
+		problems.append(_("%d degenerate faces") % (quality['degenerateFaces']))
+	if quality['shells'] > 1:
+		problems.append(_("%d shells") % (quality['shells']))
+	ret = []
+	if len(problems) > 0:
+		ret.append(', '.join(problems))
+	if len(fixes) > 0:
+		ret.append(_("Fix horrible: ") + ', '.join(fixes))
+	return ret
+
 class toolInfo(object):
 	def __init__(self, parent):
 		self.parent = parent
@@ -65,6 +90,14 @@ class toolInfo(object):
 		else:
 			glTranslate(0,-(radius + 5),0)
 		opengl.glDrawStringCenter("%dx%dx%d" % (size[0], size[1], size[2]))
+		opengl.glDrawStringCenter(_("%.1fcm3, area %.1fcm2") % (self.parent.getObjectVolume() / 1000, self.parent.getObjectSurfaceArea() / 100), 1)
+		quality = self.parent.getObjectQuality()
+		if quality is not None:
+			glColor3ub(200,0,0)
+			lines = _qualityText(quality)
+			for n in xrange(0, len(lines)):
+				opengl.glDrawStringCenter(lines[n], n + 2)
+			glColor3ub(0,0,0)
 		glPopMatrix()
 
 		glColor(255,255,255)
@@ -0,0 +1,184 @@
+from __future__ import absolute_import
+__copyright__ = "Copyright (C) 2013 David Braam - Released under terms of the AGPLv3 License"
+
+import numpy
+
+#convexHull3D returns the indexes of the points that are vertexes of the 3D convex hull of the given points.
+#The extremes of any linear transform of the points, like the bounding box and the boundary circle after a rotation or scale,
+# are always reached at a hull vertex. So the hull vertexes can be used instead of the full mesh for those calculations.
+#This is a quickhull: start with a tetrahedron, and repeatedly add the point that is farthest outside a face, replacing all faces
+# that this point can see. The face tests are done with numpy on all faces at once. If the points are flat or too few for a
+# tetrahedron, all point indexes are returned, which is always correct but not smaller.
+#Every added point costs a pass over the live faces, so a hull with many vertexes (like a finely tessellated sphere) is
+# slow to build, while transforming all points instead is cheap. So when the hull gets more then maxVertexes vertexes,
+# all point indexes are returned as well. The replaced faces are removed from the face arrays once they outnumber the live ones.
+def convexHull3D(points, maxVertexes = 1000):
+	points = numpy.asarray(points, numpy.float64)
+	count = len(points)
+	allIndexes = numpy.arange(0, count)
+	if count < 5:
+		return allIndexes
+	scale = numpy.max(numpy.abs(points))
+	if scale <= 0:
+		return allIndexes
+	eps = scale * 1e-9
+
+	#Initial tetrahedron from the points farthest apart on X, the point farthest from that line and the point farthest from that plane.
+	a = numpy.argmin(points[::,0])
+	b = numpy.argmax(points[::,0])
+	ab = points[b] - points[a]
+	if numpy.dot(ab, ab) <= eps * eps:
+		return allIndexes
+	ap = points - points[a]
+	cross = numpy.cross(ap, ab)
+	c = numpy.argmax(numpy.sum(cross * cross, 1))
+	normal = numpy.cross(ab, points[c] - points[a])
+	if numpy.dot(normal, normal) <= eps * eps:
+		return allIndexes
+	normal /= numpy.sqrt(numpy.dot(normal, normal))
+	planeDistance = numpy.dot(ap, normal)
+	d = numpy.argmax(numpy.abs(planeDistance))
+	if abs(planeDistance[d]) <= eps:
+		return allIndexes
+	if planeDistance[d] > 0:
+		b, c = c, b
+
+	faceList = []
+	faceNormals = numpy.zeros((0, 3), numpy.float64)
+	faceOffsets = numpy.zeros((0,), numpy.float64)
+	faceAlive = numpy.zeros((0,), numpy.bool)
+	faceOutside = []
+
+	def addFaces(newFaces):
+		normals = numpy.cross(points[newFaces[::,1]] - points[newFaces[::,0]], points[newFaces[::,2]] - points[newFaces[::,0]])
+		lens = numpy.sqrt(numpy.sum(normals * normals, 1))
+		lens[lens == 0] = 1
+		normals /= lens.reshape((len(lens), 1))
+		offsets = numpy.sum(normals * points[newFaces[::,0]], 1)
+		for face in newFaces.tolist():
+			faceList.append(face)
+			faceOutside.append(None)
+		return numpy.concatenate((faceNormals, normals)), numpy.concatenate((faceOffsets, offsets)), numpy.concatenate((faceAlive, numpy.ones((len(newFaces),), numpy.bool)))
+
+	def assignOutside(candidates, faceIndexes):
+		#Give every candidate point to the new face it is farthest outside of, points inside all new faces are dropped.
+		if len(candidates) < 1:
+			return
+		distances = numpy.dot(points[candidates], faceNormals[faceIndexes].T) - faceOffsets[faceIndexes]
+		best = numpy.argmax(distances, 1)
+		bestDistance = distances[numpy.arange(0, len(candidates)), best]
+		outside = bestDistance > eps
+		candidates = candidates[outside]
+		best = best[outside]
+		for n in xrange(0, len(faceIndexes)):
+			faceCandidates = candidates[best == n]
+			if len(faceCandidates) > 0:
+				faceOutside[faceIndexes[n]] = faceCandidates
+
+	faceNormals, faceOffsets, faceAlive = addFaces(numpy.array([[a, b, c], [a, d, b], [b, d, c], [c, d, a]]))
+	assignOutside(allIndexes, numpy.arange(0, 4))
+
+	vertexCount = 4
+	aliveCount = 4
+	todo = [n for n in xrange(0, len(faceList)) if faceOutside[n] is not None]
+	while len(todo) > 0:
+		if aliveCount * 2 < len(faceList):
+			keep = numpy.nonzero(faceAlive)[0]
+			newIndex = numpy.zeros((len(faceList),), numpy.intp) - 1
+			newIndex[keep] = numpy.arange(0, len(keep))
+			faceList[:] = [faceList[n] for n in keep]
+			faceOutside[:] = [faceOutside[n] for n in keep]
+			faceNormals = faceNormals[keep]
+			faceOffsets = faceOffsets[keep]
+			faceAlive = faceAlive[keep]
+			todo = [newIndex[n] for n in todo if newIndex[n] >= 0]
+			if len(todo) < 1:
+				break
+		face = todo.pop()
+		if not faceAlive[face] or faceOutside[face] is None:
+			continue
+		candidates = faceOutside[face]
+		eye = candidates[numpy.argmax(numpy.dot(points[candidates], faceNormals[face]) - faceOffsets[face])]
+
+		#All faces that see the eye point are replaced, the edges on the border of that region form the new faces with the eye point.
+		visible = numpy.nonzero(faceAlive & (numpy.dot(faceNormals, points[eye]) - faceOffsets > eps))[0]
+		edgeSet = set()
+		for n in visible:
+			f = faceList[n]
+			edgeSet.add((f[0], f[1]))
+			edgeSet.add((f[1], f[2]))
+			edgeSet.add((f[2], f[0]))
+		horizon = [e for e in edgeSet if (e[1], e[0]) not in edgeSet]
+		if len(horizon) < 3:
+			return allIndexes
+
+		candidateList = []
+		for n in visible:
+			if faceOutside[n] is not None:
+				candidateList.append(faceOutside[n])
+				faceOutside[n] = None
+		faceAlive[visible] = False
+		aliveCount -= len(visible)
+		vertexCount += 1
+		if vertexCount > maxVertexes:
+			return allIndexes
+		candidates = numpy.concatenate(candidateList)
+		candidates = candidates[candidates != eye]
+
+		first = len(faceList)
+		faceNormals, faceOffsets, faceAlive = addFaces(numpy.array([[e[0], e[1], eye] for e in horizon]))
+		newFaces = numpy.arange(first, len(faceList))
+		aliveCount += len(newFaces)
+		assignOutside(candidates, newFaces)
+		for n in newFaces:
+			if faceOutside[n] is not None:
+				todo.append(n)
+
+	alive = numpy.array([faceList[n] for n in numpy.nonzero(faceAlive)[0]])
+	return numpy.unique(alive.reshape(alive.size))
+
+#convexHull2D returns the points of the 2D convex hull of the given points counter-clockwise, without collinear points.
+#This is the monotone chain algorithm: after sorting the points on X (and Y), the lower and the upper half of the hull
+# are each build in a single pass, dropping the last point while it does not make a left turn.
+def convexHull2D(points):
+	points = numpy.asarray(points, numpy.float64)[::,0:2]
+	if len(points) < 3:
+		return points.copy()
+	order = numpy.lexsort((points[::,1], points[::,0]))
+	pointList = points[order].tolist()
+
+	def _halfHull(pointList):
+		hull = []
+		for p in pointList:
+			while len(hull) > 1 and (hull[-1][0] - hull[-2][0]) * (p[1] - hull[-2][1]) - (hull[-1][1] - hull[-2][1]) * (p[0] - hull[-2][0]) <= 0:
+				hull.pop()
+			hull.append(p)
+		return hull
+
+	lower = _halfHull(pointList)
+	upper = _halfHull(reversed(pointList))
+	return numpy.array(lower[:-1] + upper[:-1], numpy.float64)
+
+#Grow a 2D hull by a rectangle of 2*halfSize, this is the Minkowski sum of the hull and the rectangle.
+def growHull2D(hull, halfSize):
+	if halfSize[0] <= 0 and halfSize[1] <= 0:
+		return hull
+	corners = numpy.array([[-1,-1],[1,-1],[1,1],[-1,1]], numpy.float64) * numpy.asarray(halfSize, numpy.float64)[0:2]
+	return convexHull2D((hull.reshape((len(hull), 1, 2)) + corners).reshape((len(hull) * 4, 2)))
+
+#Check if 2 convex 2D polygons overlap with the separating axis test: the polygons do not overlap if there is an axis
+# on which their projections do not overlap, and the edge normals of both polygons are the only axes that need testing.
+# Polygons that only touch do not overlap. The X and Y axes are always tested, so this is never less exact then the bounding boxes.
+def hullsOverlap2D(a, b):
+	axes = [numpy.array([[1.0, 0.0], [0.0, 1.0]])]
+	for hull in [a, b]:
+		if len(hull) > 1:
+			edges = numpy.roll(hull, -1, 0) - hull
+			axes.append(numpy.array([-edges[::,1], edges[::,0]]).T)
+	axes = numpy.concatenate(axes)
+	axes = axes[numpy.any(axes != 0, 1)]
+	projectA = numpy.dot(a, axes.T)
+	projectB = numpy.dot(b, axes.T)
+	eps = 0.00001
+	separated = (numpy.max(projectA, 0) <= numpy.min(projectB, 0) + eps) | (numpy.max(projectB, 0) <= numpy.min(projectA, 0) + eps)
+	return not numpy.any(separated)
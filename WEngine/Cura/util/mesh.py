@@ -4,10 +4,204 @@ __copyright__ = "Copyright (C) 2013 David Braam - Released under terms of the AG
 import time
 import math
 import os
+import threading
+import multiprocessing
+import Queue
 
 import numpy
 numpy.seterr(all='ignore')
 
+from Cura.util import convexHull
+from Cura.util import meshKernels
+from Cura.util import meshSimplify
+
+#weldVertexes merges equal vertexes, it returns the array of unique vertexes and for each input vertex the index of its
+# unique vertex. Without a tolerance only exactly equal vertexes are merged. With a tolerance the vertexes are snapped to
+# a grid of that size first, so vertexes that differ by rounding errors are merged as well.
+#Sorting the (snapped) coordinates puts equal vertexes next to each other, so this runs in O(n log n) without any python loops.
+#The indexes are numpy.intp, which take and bincount accept on every platform. Only the GL index buffers use uint32.
+def weldVertexes(vertexes, tolerance = None):
+	count = len(vertexes)
+	if tolerance is None:
+		keys = vertexes
+	else:
+		keys = numpy.floor(vertexes / tolerance + 0.5).astype(numpy.int64)
+	order = numpy.lexsort((keys[::,2], keys[::,1], keys[::,0]))
+	sortedKeys = keys[order]
+	first = numpy.ones((count,), numpy.bool)
+	if count > 1:
+		first[1:] = numpy.any(sortedKeys[1:] != sortedKeys[:-1], 1)
+	indexes = numpy.zeros((count,), numpy.intp)
+	indexes[order] = numpy.cumsum(first) - 1
+	return numpy.array(vertexes[order[first]], numpy.float32), indexes
+
+#labelComponents finds the connected parts of an indexed mesh. It returns for each vertex the lowest vertex index of its part.
+#This is a union-find on arrays: every round all edges between different parts hook the higher root onto the lowest root
+# it touches, after which pointer jumping flattens the trees again. Only the edges between different parts are kept for
+# the next round, so the amount of work drops quickly and a few rounds are enough for normal meshes.
+def labelComponents(faces, vertexCount, callback = None):
+	parent = numpy.arange(0, vertexCount)
+	u = numpy.concatenate((faces[::,0], faces[::,1], faces[::,2])).astype(numpy.int64)
+	v = numpy.concatenate((faces[::,1], faces[::,2], faces[::,0])).astype(numpy.int64)
+	edgeCount = max(len(u), 1)
+	while len(u) > 0:
+		u = parent[u]
+		v = parent[v]
+		different = u != v
+		u = u[different]
+		v = v[different]
+		if len(u) < 1:
+			break
+		if callback is not None:
+			callback(100 - len(u) * 100 / edgeCount)
+		high = numpy.maximum(u, v)
+		low = numpy.minimum(u, v)
+		#After sorting on the high root, the first entry of each group holds the lowest root it is connected to.
+		order = numpy.lexsort((low, high))
+		high = high[order]
+		low = low[order]
+		first = numpy.ones((len(high),), numpy.bool)
+		first[1:] = high[1:] != high[:-1]
+		parent[high[first]] = numpy.minimum(parent[high[first]], low[first])
+		while True:
+			grandParent = parent[parent]
+			if numpy.all(grandParent == parent):
+				break
+			parent = grandParent
+	return parent
+
+#analyzeMesh checks an indexed mesh for the problems that the slicer has to fix up, and returns a dict with the amount of:
+# boundaryEdges (edges with only 1 face, so holes), nonManifoldEdges (edges with more then 2 faces), degenerateFaces
+# (faces without area), flippedFaces (faces that are oriented against the rest of their shell, so their normal points
+# the other way) and shells (the amount of separate parts).
+#The vertexes are welded with a small tolerance first, like the slicer does. All edges are sorted on their 2 vertexes,
+# after which equal edges are next to each other and the edge counts follow from the group sizes, O(n log n) in total.
+def analyzeMesh(vertexes, indexes, vertexCount = None):
+	if vertexCount is None:
+		vertexCount = len(indexes)
+	ret = {'boundaryEdges': 0, 'nonManifoldEdges': 0, 'degenerateFaces': 0, 'flippedFaces': 0, 'shells': 0}
+	faceCount = vertexCount / 3
+	if faceCount < 1:
+		return ret
+	tris = meshKernels.indexedTriangles(vertexes, indexes, vertexCount)
+	lens = meshKernels.faceNormals(tris)[1]
+	faces = numpy.asarray(weldVertexes(vertexes, 0.001)[1], numpy.int64)[numpy.asarray(indexes[0:faceCount * 3], numpy.int64)].reshape((faceCount, 3))
+	degenerate = (lens <= 0) | (faces[::,0] == faces[::,1]) | (faces[::,1] == faces[::,2]) | (faces[::,2] == faces[::,0])
+	ret['degenerateFaces'] = int(numpy.sum(degenerate))
+	faces = faces[~degenerate]
+	if len(faces) < 1:
+		return ret
+
+	u = numpy.concatenate((faces[::,0], faces[::,1], faces[::,2]))
+	v = numpy.concatenate((faces[::,1], faces[::,2], faces[::,0]))
+	faceIndex = numpy.arange(0, len(u)) % len(faces)
+	low = numpy.minimum(u, v)
+	high = numpy.maximum(u, v)
+	order = numpy.lexsort((high, low))
+	low = low[order]
+	high = high[order]
+	first = numpy.ones((len(low),), numpy.bool)
+	first[1:] = (low[1:] != low[:-1]) | (high[1:] != high[:-1])
+	starts = numpy.nonzero(first)[0]
+	counts = numpy.diff(numpy.concatenate((starts, [len(low)])))
+	ret['boundaryEdges'] = int(numpy.sum(counts == 1))
+	ret['nonManifoldEdges'] = int(numpy.sum(counts > 2))
+
+	#2 faces that share an edge with a consistent orientation use it in opposite directions.
+	#The orientation is propagated with labelComponents on a graph with 2 nodes per face, one for its own and one for its
+	# flipped orientation. A consistent edge joins the same orientations of its 2 faces, an inconsistent edge the opposite ones.
+	# Each shell then falls apart in 2 mirrored groups, and the faces in the smaller group are the flipped ones.
+	forward = numpy.add.reduceat((u < v)[order].astype(numpy.int64), starts)
+	faceCount = len(faces)
+	sortedFaceIndex = faceIndex[order]
+	pairStarts = starts[counts == 2]
+	a = sortedFaceIndex[pairStarts]
+	b = sortedFaceIndex[pairStarts + 1]
+	flip = (forward[counts == 2] != 1) * faceCount
+	p = numpy.concatenate((a, a + faceCount))
+	q = numpy.concatenate((b + flip, b + faceCount - flip))
+	label = labelComponents(numpy.array([p, q, q]).T, faceCount * 2)
+	group = numpy.minimum(label[0:faceCount], label[faceCount:])
+	inverse = numpy.unique(group, return_inverse=True)[1]
+	total = numpy.bincount(inverse)
+	ownSide = numpy.bincount(inverse, (label[0:faceCount] == group).astype(numpy.float64))
+	ret['flippedFaces'] = int(numpy.sum(numpy.minimum(ownSide, total - ownSide)))
+
+	parent = labelComponents(faces, numpy.max(faces) + 1)
+	ret['shells'] = len(numpy.unique(parent[faces[::,0]]))
+	return ret
+
+#scoreOrientations rates a list of down directions for a set of faces, each direction is the face normal that would
+# end up pointing at the bed. For every direction it returns the overhang area (faces steeper then the overhang angle,
+# the same test as the overhang shader), the contact area (faces that lie flat on the bed) and the height of the object.
+#Rotations around the Z axis do not change these values, so a direction is all that is needed to describe an orientation.
+#The faces are split in blocks that are scored on all directions at once by a pool of threads. The work is done in numpy,
+# which releases the interpreter lock, so the blocks are scored in parallel.
+def scoreOrientations(normals, areas, points, hull, directions, overhangAngle = 60):
+	directionCount = len(directions)
+	hullDistance = numpy.dot(hull, directions.T)
+	extremes = numpy.max(hullDistance, 0)
+	heights = extremes - numpy.min(hullDistance, 0)
+	tolerance = max(numpy.max(numpy.max(hull, 0) - numpy.min(hull, 0)) * 0.001, 0.01)
+	cosOverhang = math.cos(math.radians(90 - overhangAngle))
+	blockSize = 32768
+	blockQueue = Queue.Queue()
+	for start in xrange(0, len(normals), blockSize):
+		blockQueue.put(start)
+	results = []
+
+	def _scoreWorker():
+		overhang = numpy.zeros((directionCount,), numpy.float64)
+		contact = numpy.zeros((directionCount,), numpy.float64)
+		while True:
+			try:
+				start = blockQueue.get_nowait()
+			except Queue.Empty:
+				break
+			d = numpy.dot(normals[start:start+blockSize], directions.T)
+			inPlane = numpy.dot(points[start:start+blockSize], directions.T) >= extremes - tolerance
+			a = areas[start:start+blockSize]
+			overhang += numpy.dot(a, ((d > cosOverhang) & ~inPlane).astype(numpy.float64))
+			contact += numpy.dot(a, ((d > 0.9998) & inPlane).astype(numpy.float64))
+		results.append((overhang, contact))
+
+	try:
+		threadCount = multiprocessing.cpu_count()
+	except:
+		threadCount = 1
+	threadCount = max(1, min(threadCount, blockQueue.qsize()))
+	if threadCount < 2:
+		_scoreWorker()
+	else:
+		threadList = []
+		for n in xrange(0, threadCount):
+			thread = threading.Thread(target=_scoreWorker)
+			thread.start()
+			threadList.append(thread)
+		for thread in threadList:
+			thread.join()
+	overhang = numpy.zeros((directionCount,), numpy.float64)
+	contact = numpy.zeros((directionCount,), numpy.float64)
+	for o, c in results:
+		overhang += o
+		contact += c
+	return overhang, contact, heights
+
+#rotationToBed returns the rotation matrix that turns the given direction to point down (Rodrigues), or None if it
+# already does. The matrix is transposed, because the vertexes are multiplied as row vectors.
+def rotationToBed(direction):
+	b = numpy.array([0, 0, -1], numpy.float64)
+	c = numpy.dot(direction, b)
+	if c > 0.999999:
+		return None
+	if c < -0.999999:
+		rotation = numpy.array([[1,0,0],[0,-1,0],[0,0,-1]], numpy.float64)
+	else:
+		v = numpy.cross(direction, b)
+		k = numpy.array([[0, -v[2], v[1]], [v[2], 0, -v[0]], [-v[1], v[0], 0]], numpy.float64)
+		rotation = numpy.identity(3, numpy.float64) + k + numpy.dot(k, k) / (1 + c)
+	return numpy.matrix(rotation.T, numpy.float64)
+
 class printableObject(object):
 	def __init__(self, originFilename):
 		self._originFilename = originFilename
@@ -27,9 +221,17 @@ class printableObject(object):
 		self._drawOffset = None
 		self._loadAnim = None
 		self._schematic = None
+		self._quality = None
+		self._footprint = None
+		self._grownFootprints = {}
+		self._volume = None
+		self._surfaceArea = None
 		self._relativeX = 0
 		self._relativeY = 0
 		self._relativeZ = 0
+		#Schematic objects are attached to a host object, and follow it when the host is moved or scaled.
+		self._host = None
+		self._children = []
 		self._HitCnt = 0 	 #for debug
 		self._noHitCnt = 0 #for debug
 		#self._debug = 0
@@ -42,22 +244,29 @@ class printableObject(object):
 		ret._transformedSize = self._transformedSize.copy()
 		ret._boundaryCircleSize = self._boundaryCircleSize
 		ret._drawOffset = self._drawOffset.copy()
+		ret._quality = self._quality
 		for m in self._meshList[:]:
 			m2 = ret._addMesh()
-			m2.vertexes = m.vertexes
+			m2.indexedVertexes = m.indexedVertexes
+			m2.indexes = m.indexes
+			m2.hullVertexes = m.hullVertexes
+			m2.faceNormals = m.faceNormals
+			m2.levelsOfDetail = m.levelsOfDetail
 			m2.vertexCount = m.vertexCount
 			m2.vbo = m.vbo
 			m2.vbo.incRef()
 		return ret
 
+	def buildLevelsOfDetail(self):
+		for m in self._meshList:
+			m.buildLevelsOfDetail()
+
 	def _addMesh(self):
 		m = mesh(self)
 		self._meshList.append(m)
 		return m
 
 	def _postProcessAfterLoad(self):
-		for m in self._meshList:
-			m._calculateNormals()
 		self.processMatrix()
 		if numpy.max(self.getSize()) > 10000.0:
 			for m in self._meshList:
@@ -67,20 +276,39 @@ class printableObject(object):
 			for m in self._meshList:
 				m.vertexes *= 1000.0
 			self.processMatrix()
+		#Only keep the indexed version of the meshes, the triangle soup is build again when needed.
+		for m in self._meshList:
+			m._buildIndexed()
+			m._buildHull()
+		self._analyzeQuality()
+
+	def _analyzeQuality(self):
+		#Sum the analysis of all meshes, see analyzeMesh.
+		self._quality = {'boundaryEdges': 0, 'nonManifoldEdges': 0, 'degenerateFaces': 0, 'flippedFaces': 0, 'shells': 0}
+		for m in self._meshList:
+			if m.indexes is None:
+				continue
+			for key, value in analyzeMesh(m.indexedVertexes, m.indexes, m.vertexCount).items():
+				self._quality[key] += value
+
+	def getQuality(self):
+		return self._quality
 
 	def applyMatrix(self, m):
 		self._matrix *= m
 		self.processMatrix()
 
 	def processMatrix(self):
+		self._footprint = None
+		self._volume = None
+		self._surfaceArea = None
 		self._transformedMin = numpy.array([999999999999,999999999999,999999999999], numpy.float64)
 		self._transformedMax = numpy.array([-999999999999,-999999999999,-999999999999], numpy.float64)
 		self._boundaryCircleSize = 0
 
+		#The bounds and the boundary circle are reached at the vertexes of the convex hull, so only those are transformed.
 		for m in self._meshList:
-			transformedVertexes = m.getTransformedVertexes()
-			transformedMin = transformedVertexes.min(0)
-			transformedMax = transformedVertexes.max(0)
+			transformedVertexes, transformedMin, transformedMax = m.getTransformedHullBounds()
 			for n in xrange(0, 3):
 				self._transformedMin[n] = min(transformedMin[n], self._transformedMin[n])
 				self._transformedMax[n] = max(transformedMax[n], self._transformedMax[n])
@@ -88,13 +316,16 @@ class printableObject(object):
 			#Calculate the boundary circle
 			transformedSize = transformedMax - transformedMin
 			center = transformedMin + transformedSize / 2.0
-			boundaryCircleSize = round(math.sqrt(numpy.max(((transformedVertexes[::,0] - center[0]) * (transformedVertexes[::,0] - center[0])) + ((transformedVertexes[::,1] - center[1]) * (transformedVertexes[::,1] - center[1])) + ((transformedVertexes[::,2] - center[2]) * (transformedVertexes[::,2] - center[2])))), 3)
+			boundaryCircleSize = round(meshKernels.boundaryRadius(transformedVertexes, center), 3)
 			self._boundaryCircleSize = max(self._boundaryCircleSize, boundaryCircleSize)
 		self._transformedSize = self._transformedMax - self._transformedMin
 		self._drawOffset = (self._transformedMax + self._transformedMin) / 2
 		self._drawOffset[2] = self._transformedMin[2]
 		self._transformedMax -= self._drawOffset
 		self._transformedMin -= self._drawOffset
+		if self._host is not None:
+			self.updateFromHost()
+		self._updateChildren()
 
 	def getName(self):
 		return self._name
@@ -104,6 +335,7 @@ class printableObject(object):
 		return self._position
 	def setPosition(self, newPos):
 		self._position = newPos
+		self._updateChildren()
 	def getMatrix(self):
 		return self._matrix
 
@@ -117,8 +349,31 @@ class printableObject(object):
 		return self._drawOffset
 	def setDrawOffset(self, newOff):
 		self._drawOffset = newOff
+		self._footprint = None
 	def getBoundaryCircle(self):
 		return self._boundaryCircleSize
+	def getFootprint(self, grow = None):
+		#The 2D convex hull of the object seen from above, relative to its position. With grow, the hull is grown by
+		# that distance in X and Y, for the space that has to stay free around the object. Both are kept until the matrix changes.
+		if self._footprint is None:
+			points = numpy.concatenate(map(lambda m: m.getTransformedHullVertexes()[::,0:2], self._meshList) + [numpy.zeros((0, 2), numpy.float32)])
+			self._footprint = convexHull.convexHull2D(points - self._drawOffset[0:2])
+			self._grownFootprints = {}
+		if grow is None:
+			return self._footprint
+		key = (float(grow[0]), float(grow[1]))
+		if key not in self._grownFootprints:
+			self._grownFootprints[key] = convexHull.growHull2D(self._footprint, grow)
+		return self._grownFootprints[key]
+	def getVolume(self):
+		#The volume and the surface area are kept until the matrix changes, the info tool asks for them on every draw.
+		if self._volume is None:
+			self._volume = abs(sum(map(lambda m: meshKernels.signedVolume(m.getTransformedTriangles()), self._meshList)))
+		return self._volume
+	def getSurfaceArea(self):
+		if self._surfaceArea is None:
+			self._surfaceArea = sum(map(lambda m: meshKernels.surfaceArea(m.getTransformedTriangles()), self._meshList))
+		return self._surfaceArea
 	def getSchematic(self):
 		return self._schematic
 	def getRelativeX(self):
@@ -133,6 +388,36 @@ class printableObject(object):
 		return self._relativeZ
 	def setRelativeZ(self,Z):
 		self._relativeZ = Z
+
+	def getHost(self):
+		return self._host
+	def getChildren(self):
+		return self._children
+	def attachTo(self, host, keepRelative = False):
+		#Attach this object to the host. The X and Y position relative to the host are stored as a fraction of half the host size,
+		# so the object stays on the same spot of the host when that is scaled. With keepRelative the object is moved to its
+		# old relative position on the new host, else the relative position is taken from where the object is now.
+		self.detach()
+		self._host = host
+		host._children.append(self)
+		if not keepRelative:
+			size = host.getSize()
+			self._relativeX = (self._position[0] - host.getPosition()[0]) * 2 / size[0]
+			self._relativeY = (self._position[1] - host.getPosition()[1]) * 2 / size[1]
+		self.updateFromHost()
+	def detach(self):
+		if self._host is not None:
+			self._host._children.remove(self)
+			self._host = None
+	def updateFromHost(self):
+		#Place this object on its host, at the relative position and at the relative height below the top of the host.
+		size = self._host.getSize()
+		pos = self._host.getPosition()
+		self.setPosition(numpy.array([self._relativeX * size[0] / 2 + pos[0], self._relativeY * size[1] / 2 + pos[1]], numpy.float32))
+		self.setDrawOffset(numpy.array([0,0,-size[2]-self._relativeZ], numpy.float32))
+	def _updateChildren(self):
+		for child in self._children:
+			child.updateFromHost()
 	
 
 	def mirror(self, axis):
@@ -183,48 +468,83 @@ class printableObject(object):
 		self._matrix = numpy.matrix([[x,0,0],[0,y,0],[0,0,z]], numpy.float64)
 		self.processMatrix()
 
-	def layFlat(self):
-		transformedVertexes = self._meshList[0].getTransformedVertexes()
-		minZvertex = transformedVertexes[transformedVertexes.argmin(0)[2]]
-		dotMin = 1.0
-		dotV = None
-		for v in transformedVertexes:
-			diff = v - minZvertex
-			len = math.sqrt(diff[0] * diff[0] + diff[1] * diff[1] + diff[2] * diff[2])
-			if len < 5:
+	def _getFaceData(self):
+		#The unit normals, areas and a corner point of all faces with the current matrix applied, and the transformed hull vertexes.
+		normalList = []
+		areaList = []
+		pointList = []
+		hullList = []
+		for m in self._meshList:
+			if m.vertexCount < 3:
 				continue
-			dot = (diff[2] / len)
-			if dotMin > dot:
-				dotMin = dot
-				dotV = diff
-		if dotV is None:
+			tris = m.getTransformedTriangles()
+			normals, lens = meshKernels.faceNormals(tris)
+			valid = lens > 0
+			normalList.append(normals[valid].astype(numpy.float64))
+			areaList.append(lens[valid].astype(numpy.float64) / 2)
+			pointList.append(tris[valid][::,0].astype(numpy.float64))
+			hullList.append(m.getTransformedHullVertexes().astype(numpy.float64))
+		if len(normalList) < 1:
+			return None
+		normals = numpy.concatenate(normalList)
+		if len(normals) < 1:
+			return None
+		return normals, numpy.concatenate(areaList), numpy.concatenate(pointList), numpy.concatenate(hullList)
+
+	def _getFaceDirections(self, normals, areas, count):
+		#Group the faces on the orientation of their normal, snapping the normals to a grid of 0.02 groups faces that point
+		# in the same direction within about a degree. Returns the area weighted directions of the largest groups.
+		groupNormals, group = weldVertexes(normals, 0.02)
+		#bincount only takes intp indexes on the 32 bit runtime.
+		group = numpy.asarray(group, numpy.intp)
+		groupCount = len(groupNormals)
+		candidates = numpy.argsort(numpy.bincount(group, areas, groupCount))[::-1][0:count]
+		directions = numpy.zeros((len(candidates), 3), numpy.float64)
+		for n in xrange(0, 3):
+			directions[::,n] = numpy.bincount(group, normals[::,n] * areas, groupCount)[candidates]
+		lens = numpy.sqrt(numpy.sum(directions * directions, 1))
+		lens[lens == 0] = 1
+		return directions / lens.reshape((len(lens), 1))
+
+	def layFlat(self):
+		#A stable resting position always has faces of the object in contact with the bed. So the faces are grouped on the
+		# orientation of their normal, and for the largest groups the area of the faces that lie in the outermost plane in that
+		# direction is summed. The direction with the largest contact area is rotated to point down.
+		faceData = self._getFaceData()
+		if faceData is None:
 			return
-		rad = -math.atan2(dotV[1], dotV[0])
-		self._matrix *= numpy.matrix([[math.cos(rad), math.sin(rad), 0], [-math.sin(rad), math.cos(rad), 0], [0,0,1]], numpy.float64)
-		rad = -math.asin(dotMin)
-		self._matrix *= numpy.matrix([[math.cos(rad), 0, math.sin(rad)], [0,1,0], [-math.sin(rad), 0, math.cos(rad)]], numpy.float64)
-
-
-		transformedVertexes = self._meshList[0].getTransformedVertexes()
-		minZvertex = transformedVertexes[transformedVertexes.argmin(0)[2]]
-		dotMin = 1.0
-		dotV = None
-		for v in transformedVertexes:
-			diff = v - minZvertex
-			len = math.sqrt(diff[1] * diff[1] + diff[2] * diff[2])
-			if len < 5:
-				continue
-			dot = (diff[2] / len)
-			if dotMin > dot:
-				dotMin = dot
-				dotV = diff
-		if dotV is None:
+		normals, areas, points, hull = faceData
+		directions = self._getFaceDirections(normals, areas, 64)
+		overhang, contact, heights = scoreOrientations(normals, areas, points, hull, directions)
+		best = numpy.argmax(contact)
+		if contact[best] <= 0:
 			return
-		if dotV[1] < 0:
-			rad = math.asin(dotMin)
-		else:
-			rad = -math.asin(dotMin)
-		self.applyMatrix(numpy.matrix([[1,0,0], [0, math.cos(rad), math.sin(rad)], [0, -math.sin(rad), math.cos(rad)]], numpy.float64))
+		rotation = rotationToBed(directions[best])
+		if rotation is not None:
+			self.applyMatrix(rotation)
+
+	def autoOrient(self):
+		#Try the directions of the largest flat areas, the axis and the diagonal directions and the current orientation, and
+		# rotate to the one with the least overhang, the most contact area with the bed and the lowest height.
+		# The areas and the height are relative to the total area and the size of the object, so the weights work for any size.
+		faceData = self._getFaceData()
+		if faceData is None:
+			return
+		normals, areas, points, hull = faceData
+		steps = numpy.array([-1, 0, 1], numpy.float64)
+		fixed = numpy.array([[x, y, z] for x in steps for y in steps for z in steps if x != 0 or y != 0 or z != 0], numpy.float64)
+		fixed /= numpy.sqrt(numpy.sum(fixed * fixed, 1)).reshape((len(fixed), 1))
+		directions = numpy.concatenate((numpy.array([[0, 0, -1]], numpy.float64), self._getFaceDirections(normals, areas, 32), fixed))
+		overhang, contact, heights = scoreOrientations(normals, areas, points, hull, directions)
+		totalArea = max(numpy.sum(areas), 0.0001)
+		diagonal = max(numpy.sqrt(numpy.sum((numpy.max(hull, 0) - numpy.min(hull, 0)) ** 2)), 0.0001)
+		score = overhang / totalArea - contact / totalArea * 0.5 + heights / diagonal * 0.25
+		best = numpy.argmin(score)
+		if best == 0 or score[best] >= score[0]:
+			return
+		rotation = rotationToBed(directions[best])
+		if rotation is not None:
+			self.applyMatrix(rotation)
 
 	def scaleUpTo(self, size):
 		vMin = self._transformedMin
@@ -252,35 +572,76 @@ class printableObject(object):
 
 	#getVertexIndexList returns an array of vertexes, and an integer array for each mesh in this object.
 	# the integer arrays are indexes into the vertex array for each triangle in the model.
+	# Only the unique vertexes of the meshes are welded, the triangle indexes of the meshes are remapped to the result.
 	def getVertexIndexList(self):
-		vertexMap = {}
 		vertexList = []
-		meshList = []
 		for m in self._meshList:
-			verts = m.getTransformedVertexes(True)
-			meshIdxList = []
-			for idx in xrange(0, len(verts)):
-				v = verts[idx]
-				hashNr = int(v[0] * 100) | int(v[1] * 100) << 10 | int(v[2] * 100) << 20
-				vIdx = None
-				if hashNr in vertexMap:
-					for idx2 in vertexMap[hashNr]:
-						if numpy.linalg.norm(v - vertexList[idx2]) < 0.001:
-							vIdx = idx2
-				if vIdx is None:
-					vIdx = len(vertexList)
-					vertexMap[hashNr] = [vIdx]
-					vertexList.append(v)
-				meshIdxList.append(vIdx)
-			meshList.append(numpy.array(meshIdxList, numpy.int32))
-		return numpy.array(vertexList, numpy.float32), meshList
-
+			vertexList.append(m.getTransformedIndexedVertexes(True))
+		if len(vertexList) < 1:
+			return numpy.zeros((0, 3), numpy.float32), []
+		vertexes, remap = weldVertexes(numpy.concatenate(vertexList), 0.001)
+		meshList = []
+		offset = 0
+		for n in xrange(0, len(self._meshList)):
+			m = self._meshList[n]
+			if m.isIndexed():
+				indexes = m.indexes
+			else:
+				indexes = numpy.arange(0, m.vertexCount)
+			meshList.append(numpy.array(remap[indexes + offset], numpy.int32))
+			offset += len(vertexList[n])
+		return vertexes, meshList
+
+#A mesh is stored as an array of unique vertexes (indexedVertexes) with an index array that holds 3 indexes for each triangle.
+# While loading, the loaders fill a plain triangle soup through the vertexes attribute, which is converted to the indexed
+# version by _buildIndexed after loading. Reading vertexes after that builds the triangle soup again from the indexed data.
 class mesh(object):
 	def __init__(self, obj):
-		self.vertexes = None
+		self._vertexes = None
+		self.indexedVertexes = None
+		self.indexes = None
+		self.hullVertexes = None
+		self.faceNormals = None
+		self.levelsOfDetail = []
+		self.lodVboList = []
 		self.vertexCount = 0
 		self.vbo = None
 		self._obj = obj
+		self._transformedBuffer = None
+		self._transformedMatrix = None
+
+	def _getVertexes(self):
+		if self._vertexes is not None or self.indexes is None:
+			return self._vertexes
+		return numpy.take(self.indexedVertexes, self.indexes, axis=0)
+
+	def _setVertexes(self, vertexes):
+		self._vertexes = vertexes
+		self.indexedVertexes = None
+		self.indexes = None
+		self.hullVertexes = None
+		self.faceNormals = None
+		self.levelsOfDetail = []
+		self._transformedMatrix = None
+
+	vertexes = property(_getVertexes, _setVertexes)
+
+	def isIndexed(self):
+		return self.indexes is not None
+
+	def _buildIndexed(self):
+		#Only exactly equal vertexes are merged, so the triangle soup can be rebuild without any change.
+		if self._vertexes is None:
+			return
+		self.indexedVertexes, self.indexes = weldVertexes(self._vertexes[0:self.vertexCount])
+		self._vertexes = None
+		self.hullVertexes = None
+		self._transformedMatrix = None
+
+	def _buildHull(self):
+		if self.indexes is None:
+			return
+		self.hullVertexes = numpy.array(self.indexedVertexes[convexHull.convexHull3D(self.indexedVertexes)], numpy.float32)
 
 	def _addFace(self, x0, y0, z0, x1, y1, z1, x2, y2, z2):
 		n = self.vertexCount
@@ -300,96 +661,134 @@ class mesh(object):
 	def _prepareFaceCount(self, faceNumber):
 		#Set the amount of faces before loading data in them. This way we can create the numpy arrays before we fill them.
 		self.vertexes = numpy.zeros((faceNumber*3, 3), numpy.float32)
-		self.normal = numpy.zeros((faceNumber*3, 3), numpy.float32)
 		self.vertexCount = 0
 
+	def buildLevelsOfDetail(self, minFaceCount = 5000):
+		#Simplified versions of the mesh for drawing, each with about a quarter of the faces of the one before.
+		# Each level is a tuple of unique vertexes and triangle indexes. They are only used to draw the mesh,
+		# slicing and saving always use the full mesh. The list is filled in place in a single step, so this can run in a thread,
+		# and copies of the object, which share the list, get the levels as well.
+		if self.indexes is None:
+			return
+		levels = []
+		vertexes = self.indexedVertexes
+		indexes = self.indexes[0:self.vertexCount]
+		while len(levels) < 3 and len(indexes) / 3 / 4 >= minFaceCount:
+			faceCount = len(indexes) / 3
+			vertexes, indexes = meshSimplify.simplifyMesh(vertexes, indexes, faceCount / 4)
+			if len(indexes) / 3 > faceCount * 3 / 4:
+				break
+			levels.append((vertexes, indexes))
+		self.levelsOfDetail[:] = levels
+
+	def getFaceNormals(self):
+		#The normal of each face, in mesh coordinates. The shaders derive flat normals themselves, so these are only
+		# calculated when they are needed, like for the fixed function rendering, and then kept with the mesh.
+		if self.faceNormals is None:
+			self._calculateNormals()
+		return self.faceNormals
+
 	def _calculateNormals(self):
-		#Calculate the normals
-		tris = self.vertexes.reshape(self.vertexCount / 3, 3, 3)
-		normals = numpy.cross( tris[::,1 ] - tris[::,0]  , tris[::,2 ] - tris[::,0] )
-		lens = numpy.sqrt( normals[:,0]**2 + normals[:,1]**2 + normals[:,2]**2 )
-		normals[:,0] /= lens
-		normals[:,1] /= lens
-		normals[:,2] /= lens
-		
-		n = numpy.zeros((self.vertexCount / 3, 9), numpy.float32)
-		n[:,0:3] = normals
-		n[:,3:6] = normals
-		n[:,6:9] = normals
-		self.normal = n.reshape(self.vertexCount, 3)
-		self.invNormal = -self.normal
-
-	def _vertexHash(self, idx):
-		v = self.vertexes[idx]
-		return int(v[0] * 100) | int(v[1] * 100) << 10 | int(v[2] * 100) << 20
-
-	def _idxFromHash(self, map, idx):
-		vHash = self._vertexHash(idx)
-		for i in map[vHash]:
-			if numpy.linalg.norm(self.vertexes[i] - self.vertexes[idx]) < 0.001:
-				return i
+		if self.indexes is not None:
+			tris = meshKernels.indexedTriangles(self.indexedVertexes, self.indexes, self.vertexCount)
+		else:
+			tris = self._vertexes[0:self.vertexCount - self.vertexCount % 3].reshape((self.vertexCount / 3, 3, 3))
+		self.faceNormals = meshKernels.faceNormals(tris)[0]
 
 	def getTransformedVertexes(self, applyOffsets = False):
+		#The transform is done on the unique vertexes, the triangle soup is build from the result.
+		transformed = self.getTransformedIndexedVertexes(applyOffsets)
+		if self.indexes is not None:
+			return numpy.take(transformed, self.indexes, axis=0)
+		if not applyOffsets:
+			return transformed.copy()
+		return transformed
+
+	def getTransformedIndexedVertexes(self, applyOffsets = False):
+		#The transformed unique vertexes, for things like the bounds that do not need the triangles.
+		# Without offsets this returns the cached buffer of the mesh, which should not be modified.
+		transformed = self._getTransformedBuffer()
 		if applyOffsets:
 			pos = self._obj._position.copy()
 			pos.resize((3))
 			pos[2] = self._obj.getSize()[2] / 2
 			offset = self._obj._drawOffset.copy()
 			offset[2] += self._obj.getSize()[2] / 2
-			return (numpy.matrix(self.vertexes, copy = False) * numpy.matrix(self._obj._matrix, numpy.float32)).getA() - offset + pos
-		return (numpy.matrix(self.vertexes, copy = False) * numpy.matrix(self._obj._matrix, numpy.float32)).getA()
+			return transformed - (offset - pos)
+		return transformed
+
+	def getTransformedHullVertexes(self):
+		return self.getTransformedHullBounds()[0]
+
+	def getTransformedHullBounds(self):
+		#The transformed hull vertexes, with their minimum and maximum.
+		if self.hullVertexes is None:
+			transformed = self.getTransformedIndexedVertexes()
+			if len(transformed) < 1:
+				return transformed, numpy.zeros((3,), numpy.float64), numpy.zeros((3,), numpy.float64)
+			return transformed, transformed.min(0).astype(numpy.float64), transformed.max(0).astype(numpy.float64)
+		return meshKernels.transformWithBounds(self.hullVertexes, self._obj._matrix)
+
+	def getTransformedTriangles(self):
+		#The transformed triangles as an Nx3x3 array.
+		transformed = self.getTransformedIndexedVertexes()
+		if self.indexes is not None:
+			return meshKernels.indexedTriangles(transformed, self.indexes, self.vertexCount)
+		return transformed[0:self.vertexCount - self.vertexCount % 3].reshape((self.vertexCount / 3, 3, 3))
+
+	def _getTransformedBuffer(self):
+		#The transformed vertexes are kept in a buffer that is reused, and only calculated again when the matrix of the object
+		# differs from the matrix used for the buffer. Comparing the 9 matrix values is cheap, and also catches in place changes.
+		if self.indexes is not None:
+			vertexes = self.indexedVertexes
+		else:
+			vertexes = self._vertexes[0:self.vertexCount]
+		matrix = numpy.array(self._obj._matrix, numpy.float32)
+		if self._transformedBuffer is None or len(self._transformedBuffer) != len(vertexes):
+			self._transformedBuffer = numpy.zeros((len(vertexes), 3), numpy.float32)
+			self._transformedMatrix = None
+		if self._transformedMatrix is None or not numpy.array_equal(self._transformedMatrix, matrix):
+			numpy.dot(numpy.asarray(vertexes, numpy.float32), matrix, self._transformedBuffer)
+			self._transformedMatrix = matrix
+		return self._transformedBuffer
 
 	def split(self, callback):
-		vertexMap = {}
-
-		vertexToFace = []
-		for idx in xrange(0, self.vertexCount):
-			if (idx % 100) == 0:
-				callback(idx * 100 / self.vertexCount)
-			vHash = self._vertexHash(idx)
-			if vHash not in vertexMap:
-				vertexMap[vHash] = []
-			vertexMap[vHash].append(idx)
-			vertexToFace.append([])
-
-		faceList = []
-		for idx in xrange(0, self.vertexCount, 3):
-			if (idx % 100) == 0:
-				callback(idx * 100 / self.vertexCount)
-			f = [self._idxFromHash(vertexMap, idx), self._idxFromHash(vertexMap, idx+1), self._idxFromHash(vertexMap, idx+2)]
-			vertexToFace[f[0]].append(idx / 3)
-			vertexToFace[f[1]].append(idx / 3)
-			vertexToFace[f[2]].append(idx / 3)
-			faceList.append(f)
+		#The indexes already connect the triangles that share a vertex, so the parts follow from labeling the vertexes.
+		# The indexed vertexes are only exactly equal ones, so for the labels they are welded with a tolerance first like
+		# the slicer does. Otherwise parts of which the shared vertexes differ by rounding errors fall apart.
+		if self.indexes is None:
+			self._buildIndexed()
+		if self.vertexCount < 3:
+			return []
+		faces = self.indexes.reshape((self.vertexCount / 3, 3))
+		weldIndex = weldVertexes(self.indexedVertexes, 0.001)[1]
+		vertexLabels = labelComponents(weldIndex[faces], numpy.max(weldIndex) + 1, callback)[weldIndex]
+
+		#Sort the faces and the vertexes on their part, so each part is a single slice of both.
+		faceLabels = vertexLabels[faces[::,0]]
+		faceOrder = numpy.argsort(faceLabels, kind='mergesort')
+		faceLabels = faceLabels[faceOrder]
+		vertexOrder = numpy.argsort(vertexLabels, kind='mergesort')
+		vertexLabels = vertexLabels[vertexOrder]
+		faceStarts = numpy.nonzero(numpy.concatenate(([True], faceLabels[1:] != faceLabels[:-1])))[0]
+		faceEnds = numpy.concatenate((faceStarts[1:], [len(faceLabels)]))
+		vertexStarts = numpy.searchsorted(vertexLabels, faceLabels[faceStarts])
+		vertexEnds = numpy.searchsorted(vertexLabels, faceLabels[faceStarts], 'right')
+		#The index of each vertex inside its own part. Vertexes that are not used by any face form parts without faces.
+		groupStarts = numpy.nonzero(numpy.concatenate(([True], vertexLabels[1:] != vertexLabels[:-1])))[0]
+		groupSizes = numpy.diff(numpy.concatenate((groupStarts, [len(vertexLabels)])))
+		localIndex = numpy.zeros((len(vertexLabels),), numpy.intp)
+		localIndex[vertexOrder] = numpy.arange(0, len(vertexLabels)) - numpy.repeat(groupStarts, groupSizes)
 
 		ret = []
-		doneSet = set()
-		for idx in xrange(0, len(faceList)):
-			if idx in doneSet:
-				continue
-			doneSet.add(idx)
-			todoList = [idx]
-			meshFaceList = []
-			while len(todoList) > 0:
-				idx = todoList.pop()
-				meshFaceList.append(idx)
-				for n in xrange(0, 3):
-					for i in vertexToFace[faceList[idx][n]]:
-						if not i in doneSet:
-							doneSet.add(i)
-							todoList.append(i)
-
+		for n in xrange(0, len(faceStarts)):
+			partFaces = faces[faceOrder[faceStarts[n]:faceEnds[n]]]
 			obj = printableObject(self._obj.getOriginFilename())
 			obj._matrix = self._obj._matrix.copy()
 			m = obj._addMesh()
-			m._prepareFaceCount(len(meshFaceList))
-			for idx in meshFaceList:
-				m.vertexes[m.vertexCount] = self.vertexes[faceList[idx][0]]
-				m.vertexCount += 1
-				m.vertexes[m.vertexCount] = self.vertexes[faceList[idx][1]]
-				m.vertexCount += 1
-				m.vertexes[m.vertexCount] = self.vertexes[faceList[idx][2]]
-				m.vertexCount += 1
+			m.indexedVertexes = self.indexedVertexes[vertexOrder[vertexStarts[n]:vertexEnds[n]]]
+			m.indexes = localIndex[partFaces.reshape(len(partFaces) * 3)]
+			m.vertexCount = len(partFaces) * 3
 			obj._postProcessAfterLoad()
 			ret.append(obj)
 		return ret
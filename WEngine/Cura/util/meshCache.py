@@ -0,0 +1,157 @@
+from __future__ import absolute_import
+__copyright__ = "Copyright (C) 2013 David Braam - Released under terms of the AGPLv3 License"
+
+import os
+import struct
+import hashlib
+import thread
+import numpy
+
+from Cura.util import mesh
+from Cura.util import profile
+
+#The mesh cache keeps the post-processed meshes of loaded files on disk, so loading the same file again skips
+# the parsing, the normal calculation and the unit detection. Entries are stored as a single binary blob per file,
+# named after the file size, modification time and a hash of the file contents. So a changed file never hits an old entry.
+#A blob contains a header, followed by the object and mesh information, followed by the raw data of the indexed meshes:
+# the float32 unique vertexes, the int32 triangle indexes and the float32 convex hull vertexes.
+#The indexes are used as numpy.intp in memory. Where that is int32 the mapped data is used as it is, else it is converted.
+_cacheMagic = 'CMC4'
+_objectFormat = '<I13d'
+_meshFormat = '<III'
+_sampleSize = 64 * 1024
+_sampleCount = 16
+
+def getCachePath():
+	return os.path.join(profile.getBasePath(), 'meshcache')
+
+def _getMaxCacheSize():
+	return int(profile.getPreferenceFloat('mesh_cache_size') * 1024 * 1024)
+
+def _getCacheFilename(filename):
+	#Hash a number of evenly spread samples of the file together with the size and modification time.
+	# This is a lot faster then hashing the whole file, while any normal edit still results in a new key.
+	stat = os.stat(filename)
+	h = hashlib.sha1()
+	h.update('%d:%d' % (stat.st_size, int(stat.st_mtime)))
+	f = open(filename, 'rb')
+	if stat.st_size <= _sampleSize * _sampleCount:
+		h.update(f.read())
+	else:
+		for n in xrange(0, _sampleCount):
+			f.seek((stat.st_size - _sampleSize) * n / (_sampleCount - 1))
+			h.update(f.read(_sampleSize))
+	f.close()
+	return os.path.join(getCachePath(), h.hexdigest() + '.mesh')
+
+def loadMeshes(filename):
+	#Returns the list of printableObjects for this file from the cache, or None if the file is not cached.
+	if _getMaxCacheSize() <= 0:
+		return None
+	try:
+		cacheFilename = _getCacheFilename(filename)
+		if not os.path.isfile(cacheFilename):
+			return None
+		f = open(cacheFilename, 'rb')
+		magic, objectCount = struct.unpack('<4sI', f.read(8))
+		if magic != _cacheMagic:
+			f.close()
+			return None
+		objectInfo = []
+		for n in xrange(0, objectCount):
+			info = struct.unpack(_objectFormat, f.read(struct.calcsize(_objectFormat)))
+			meshInfo = []
+			for i in xrange(0, info[0]):
+				meshInfo.append(struct.unpack(_meshFormat, f.read(struct.calcsize(_meshFormat))))
+			objectInfo.append((info[1:], meshInfo))
+		offset = f.tell()
+		f.close()
+
+		#The vertex data is mapped copy-on-write, so a cache hit only costs reading the pages that are used.
+		ret = []
+		for info, meshInfo in objectInfo:
+			obj = mesh.printableObject(filename)
+			for vertexCount, indexedVertexCount, hullVertexCount in meshInfo:
+				m = obj._addMesh()
+				m.vertexCount = vertexCount
+				if vertexCount > 0:
+					m.indexedVertexes = numpy.memmap(cacheFilename, numpy.float32, 'c', offset, (indexedVertexCount, 3))
+					offset += indexedVertexCount * 3 * 4
+					m.indexes = numpy.asarray(numpy.memmap(cacheFilename, numpy.int32, 'c', offset, (vertexCount,)), numpy.intp)
+					offset += vertexCount * 4
+					m.hullVertexes = numpy.array(numpy.memmap(cacheFilename, numpy.float32, 'r', offset, (hullVertexCount, 3)))
+					offset += hullVertexCount * 3 * 4
+				else:
+					m.indexedVertexes = numpy.zeros((0, 3), numpy.float32)
+					m.indexes = numpy.zeros((0,), numpy.intp)
+					m.hullVertexes = numpy.zeros((0, 3), numpy.float32)
+			obj._transformedMin = numpy.array(info[0:3], numpy.float64)
+			obj._transformedMax = numpy.array(info[3:6], numpy.float64)
+			obj._transformedSize = numpy.array(info[6:9], numpy.float64)
+			obj._drawOffset = numpy.array(info[9:12], numpy.float64)
+			obj._boundaryCircleSize = info[12]
+			#The quality analysis is fast enough to not store it in the cache.
+			obj._analyzeQuality()
+			ret.append(obj)
+		#Touch the entry, the modification time of the cache files is used for least recently used eviction.
+		os.utime(cacheFilename, None)
+		return ret
+	except (EnvironmentError, struct.error, ValueError):
+		return None
+
+def storeMeshes(filename, objects):
+	maxSize = _getMaxCacheSize()
+	if maxSize <= 0 or len(objects) < 1:
+		return
+	try:
+		if not os.path.isdir(getCachePath()):
+			os.makedirs(getCachePath())
+		cacheFilename = _getCacheFilename(filename)
+		tempFilename = cacheFilename + '.tmp%d_%d' % (os.getpid(), thread.get_ident())
+		f = open(tempFilename, 'wb')
+		f.write(struct.pack('<4sI', _cacheMagic, len(objects)))
+		for obj in objects:
+			values = list(obj._transformedMin) + list(obj._transformedMax) + list(obj._transformedSize) + list(obj._drawOffset) + [obj._boundaryCircleSize]
+			f.write(struct.pack(_objectFormat, len(obj._meshList), *values))
+			for m in obj._meshList:
+				if not m.isIndexed():
+					m._buildIndexed()
+				if m.hullVertexes is None:
+					m._buildHull()
+				f.write(struct.pack(_meshFormat, m.vertexCount, len(m.indexedVertexes), len(m.hullVertexes)))
+		for obj in objects:
+			for m in obj._meshList:
+				if m.vertexCount > 0:
+					f.write(numpy.asarray(m.indexedVertexes, numpy.float32).tostring())
+					f.write(numpy.asarray(m.indexes, numpy.int32).tostring())
+					f.write(numpy.asarray(m.hullVertexes, numpy.float32).tostring())
+		f.close()
+		if os.path.isfile(cacheFilename):
+			os.remove(cacheFilename)
+		os.rename(tempFilename, cacheFilename)
+	except EnvironmentError:
+		return
+	_evict(maxSize)
+
+def _evict(maxSize):
+	#Remove the least recently used entries until the cache fits in the configured size.
+	try:
+		entries = []
+		totalSize = 0
+		for name in os.listdir(getCachePath()):
+			path = os.path.join(getCachePath(), name)
+			stat = os.stat(path)
+			entries.append((stat.st_mtime, stat.st_size, path))
+			totalSize += stat.st_size
+	except EnvironmentError:
+		return
+	entries.sort()
+	for mtime, size, path in entries:
+		if totalSize <= maxSize:
+			break
+		try:
+			os.remove(path)
+		except EnvironmentError:
+			#Entries that are in use (mapped) cannot be removed on all platforms, they will be removed on a next run.
+			continue
+		totalSize -= size
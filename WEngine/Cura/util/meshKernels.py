@@ -0,0 +1,51 @@
+from __future__ import absolute_import
+__copyright__ = "Copyright (C) 2013 David Braam - Released under terms of the AGPLv3 License"
+
+import numpy
+
+#The mesh kernels are the basic geometry calculations on whole meshes. Each kernel is written to go over the data as few
+# times as possible: results are written into existing buffers where they can be, per row sums are done with einsum
+# instead of multiply-then-sum, and normalizing divides all 3 columns in one broadcast instead of one pass per column.
+#All kernels work on float32 Nx3 vertex arrays, triangles are given as Nx3x3 arrays or as vertexes with Nx3 face indexes.
+
+def transformWithBounds(vertexes, matrix, out = None):
+	#Returns the vertexes multiplied with the 3x3 matrix, and the minimum and maximum of the result.
+	matrix = numpy.asarray(matrix, numpy.float32)
+	if out is None:
+		out = numpy.zeros((len(vertexes), 3), numpy.float32)
+	if len(vertexes) < 1:
+		return out, numpy.zeros((3,), numpy.float64), numpy.zeros((3,), numpy.float64)
+	numpy.dot(numpy.asarray(vertexes, numpy.float32), matrix, out)
+	return out, out.min(0).astype(numpy.float64), out.max(0).astype(numpy.float64)
+
+def faceNormals(tris):
+	#Returns the unit normal of each triangle and the length of the cross product, which is twice the triangle area.
+	# Degenerate triangles get a zero normal.
+	normals = numpy.cross(tris[::,1] - tris[::,0], tris[::,2] - tris[::,0])
+	lens = numpy.sqrt(numpy.einsum('ij,ij->i', normals, normals))
+	normals /= numpy.where(lens > 0, lens, 1).reshape((len(lens), 1))
+	return normals, lens
+
+def surfaceArea(tris):
+	normals = numpy.cross(tris[::,1] - tris[::,0], tris[::,2] - tris[::,0])
+	return float(numpy.sum(numpy.sqrt(numpy.einsum('ij,ij->i', normals, normals)), dtype=numpy.float64)) / 2
+
+def signedVolume(tris):
+	#The sum of the signed volumes of the tetrahedrons between the origin and each triangle. For a closed mesh with
+	# outward facing triangles this is the volume of the mesh, independent of where the origin is.
+	v0 = numpy.asarray(tris[::,0], numpy.float64)
+	return float(numpy.einsum('ij,ij->', v0, numpy.cross(tris[::,1], tris[::,2]).astype(numpy.float64))) / 6
+
+def boundaryRadius(vertexes, center):
+	#The distance from the center to the farthest vertex.
+	if len(vertexes) < 1:
+		return 0.0
+	diff = vertexes - numpy.asarray(center, numpy.float32)
+	return float(numpy.sqrt(numpy.max(numpy.einsum('ij,ij->i', diff, diff))))
+
+def indexedTriangles(vertexes, indexes, count = None):
+	#Expands vertexes and a flat index list (3 per triangle) to an Nx3x3 triangle array.
+	if count is None:
+		count = len(indexes)
+	count -= count % 3
+	return vertexes[numpy.asarray(indexes[0:count], numpy.int64).reshape((count / 3, 3))]
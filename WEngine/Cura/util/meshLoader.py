@@ -2,11 +2,16 @@ from __future__ import absolute_import
 __copyright__ = "Copyright (C) 2013 David Braam - Released under terms of the AGPLv3 License"
 
 import os
+import threading
+import traceback
+import multiprocessing
+import Queue
 
 from Cura.util.meshLoaders import stl
 from Cura.util.meshLoaders import obj
 from Cura.util.meshLoaders import dae
 from Cura.util.meshLoaders import amf
+from Cura.util import meshCache
 
 def loadSupportedExtensions():
 	return ['.stl', '.obj', '.dae', '.amf']
@@ -27,19 +32,75 @@ def saveWildcardFilter():
 # OBJ files usually contain a single mesh, but they can contain multiple meshes
 # AMF can contain whole scenes of objects with each object having multiple meshes.
 # DAE files are a mess, but they can contain scenes of objects as well as grouped meshes
+# Loaded files are stored in the mesh cache, so loading the same file again does not need to parse it.
+#The optional callback is called with the progress and the partially loaded mesh (or None) for loaders that support it.
+# Returning True from the callback aborts the load, and an empty list is returned.
 
-def loadMeshes(filename):
+def loadMeshes(filename, callback = None):
+	ret = meshCache.loadMeshes(filename)
+	if ret is not None:
+		return ret
 	ext = os.path.splitext(filename)[1].lower()
 	if ext == '.stl':
-		return stl.loadScene(filename)
-	if ext == '.obj':
-		return obj.loadScene(filename)
-	if ext == '.dae':
-		return dae.loadScene(filename)
-	if ext == '.amf':
-		return amf.loadScene(filename)
-	print 'Error: Unknown model extension: %s' % (ext)
-	return []
+		ret = stl.loadScene(filename, callback)
+	elif ext == '.obj':
+		ret = obj.loadScene(filename)
+	elif ext == '.dae':
+		ret = dae.loadScene(filename)
+	elif ext == '.amf':
+		ret = amf.loadScene(filename)
+	else:
+		print 'Error: Unknown model extension: %s' % (ext)
+		return []
+	meshCache.storeMeshes(filename, ret)
+	return ret
+
+#loadMeshesThreaded loads a list of files with a pool of worker threads, one for each core.
+# Only the file reading and the memory mapped binary STL loading overlap between the threads. The ASCII STL, OBJ, AMF and
+# DAE parsers and the post processing after loading (welding, hull and quality analysis) hold the interpreter lock, so
+# that work is still done one file at a time. The threads keep the GUI responsive and overlap the waiting on the disk.
+# The resulting arrays are shared with the caller, so nothing is copied or pickled between the workers and the caller.
+# resultCallback(filename, objList) is called from the worker threads when a file is done, the caller should pass
+# the objects to its own thread for adding them to the scene. progressCallback(filename, progress, mesh) works like the
+# callback of loadMeshes, returning True aborts the file that is loading and skips all files that are not started yet.
+def loadMeshesThreaded(fileList, resultCallback, progressCallback = None):
+	fileQueue = Queue.Queue()
+	for filename in fileList:
+		fileQueue.put(filename)
+	aborted = [False]
+
+	def _loadWorker():
+		while not aborted[0]:
+			try:
+				filename = fileQueue.get_nowait()
+			except Queue.Empty:
+				return
+			callback = None
+			if progressCallback is not None:
+				def callback(progress, m, filename = filename):
+					if progressCallback(filename, progress, m):
+						aborted[0] = True
+					return aborted[0]
+			try:
+				ret = loadMeshes(filename, callback)
+			except:
+				traceback.print_exc()
+				ret = []
+			if not aborted[0]:
+				resultCallback(filename, ret)
+
+	try:
+		threadCount = multiprocessing.cpu_count()
+	except:
+		threadCount = 1
+	threadCount = max(1, min(threadCount, len(fileList)))
+	threadList = []
+	for n in xrange(0, threadCount):
+		thread = threading.Thread(target=_loadWorker)
+		thread.daemon = True
+		thread.start()
+		threadList.append(thread)
+	return threadList
 
 def saveMeshes(filename, objects):
 	ext = os.path.splitext(filename)[1].lower()
@@ -4,6 +4,8 @@ __copyright__ = "Copyright (C) 2013 David Braam - Released under terms of the AG
 import cStringIO as StringIO
 import zipfile
 import os
+import array
+import numpy
 try:
 	from xml.etree import cElementTree as ElementTree
 except:
@@ -12,73 +14,116 @@ except:
 from Cura.util import mesh
 from Cura.util import profile
 
+def _addVolume(obj, vertexList, indexList):
+	#Gather the triangle soup of a volume from the mesh vertexes with a single index operation.
+	m = obj._addMesh()
+	faceCount = len(indexList) / 3
+	m._prepareFaceCount(faceCount)
+	if faceCount < 1 or len(vertexList) < 3:
+		return
+	vertexes = numpy.frombuffer(vertexList, numpy.float32).reshape((len(vertexList) / 3, 3))
+	indexes = numpy.frombuffer(indexList, numpy.intc)[0:faceCount * 3]
+	numpy.take(vertexes, indexes, axis=0, out=m.vertexes)
+	m.vertexCount = faceCount * 3
+
+#The elements that are done when they end. The x, y, z and v1, v2, v3 elements are read when their parent ends.
+_processedTags = ['coordinates', 'vertex', 'vertices', 'triangle', 'volume', 'mesh', 'object']
+
 def loadScene(filename):
 	try:
 		zfile = zipfile.ZipFile(filename)
-		xml = zfile.read(zfile.namelist()[0])
-		zfile.close()
+		stream = zfile.open(zfile.namelist()[0])
 	except zipfile.BadZipfile:
-		f = open(filename, "r")
-		xml = f.read()
-		f.close()
-	amf = ElementTree.fromstring(xml)
-	if 'unit' in amf.attrib:
-		unit = amf.attrib['unit'].lower()
-	else:
-		unit = 'millimeter'
-	if unit == 'millimeter':
-		scale = 1.0
-	elif unit == 'meter':
-		scale = 1000.0
-	elif unit == 'inch':
-		scale = 25.4
-	elif unit == 'feet':
-		scale = 304.8
-	elif unit == 'micron':
-		scale = 0.001
-	else:
-		print "Unknown unit in amf: %s" % (unit)
-		scale = 1.0
+		zfile = None
+		stream = open(filename, "rb")
 
+	#Parse the XML incrementally, coordinates and triangle indexes are collected in typed arrays
+	# and every element is removed from its parent as soon as it is processed, so the full tree is never kept in memory.
+	# Only clearing an element is not enough, the empty element would stay in its parent until the parent ends.
 	ret = []
-	for amfObj in amf.iter('object'):
-		obj = mesh.printableObject(filename)
-		for amfMesh in amfObj.iter('mesh'):
-			vertexList = []
-			for vertices in amfMesh.iter('vertices'):
-				for vertex in vertices.iter('vertex'):
-					for coordinates in vertex.iter('coordinates'):
-						v = [0.0,0.0,0.0]
-						for t in coordinates:
-							if t.tag == 'x':
-								v[0] = float(t.text)
-							elif t.tag == 'y':
-								v[1] = float(t.text)
-							elif t.tag == 'z':
-								v[2] = float(t.text)
-						vertexList.append(v)
-
-			for volume in amfMesh.iter('volume'):
-				m = obj._addMesh()
-				count = 0
-				for triangle in volume.iter('triangle'):
-					count += 1
-				m._prepareFaceCount(count)
+	obj = None
+	vertexList = array.array('f')
+	indexList = array.array('i')
+	parentList = []
+	for event, element in ElementTree.iterparse(stream, ('start', 'end')):
+		if event == 'start':
+			parentList.append(element)
+			if element.tag == 'amf':
+				if 'unit' in element.attrib:
+					unit = element.attrib['unit'].lower()
+				else:
+					unit = 'millimeter'
+				if unit == 'millimeter':
+					scale = 1.0
+				elif unit == 'meter':
+					scale = 1000.0
+				elif unit == 'inch':
+					scale = 25.4
+				elif unit == 'feet':
+					scale = 304.8
+				elif unit == 'micron':
+					scale = 0.001
+				else:
+					print "Unknown unit in amf: %s" % (unit)
+					scale = 1.0
+			elif element.tag == 'object':
+				obj = mesh.printableObject(filename)
+			elif element.tag == 'mesh':
+				vertexList = array.array('f')
+			elif element.tag == 'volume':
+				indexList = array.array('i')
+			continue
 
-				for triangle in volume.iter('triangle'):
-					for t in triangle:
-						if t.tag == 'v1':
-							v1 = vertexList[int(t.text)]
-						elif t.tag == 'v2':
-							v2 = vertexList[int(t.text)]
-						elif t.tag == 'v3':
-							v3 = vertexList[int(t.text)]
-							m._addFace(v1[0], v1[1], v1[2], v2[0], v2[1], v2[2], v3[0], v3[1], v3[2])
-		obj._postProcessAfterLoad()
-		ret.append(obj)
+		parentList.pop()
+		if element.tag == 'coordinates':
+			v = [0.0,0.0,0.0]
+			for t in element:
+				if t.tag == 'x':
+					v[0] = float(t.text)
+				elif t.tag == 'y':
+					v[1] = float(t.text)
+				elif t.tag == 'z':
+					v[2] = float(t.text)
+			vertexList.extend(v)
+		elif element.tag == 'triangle':
+			v = [0,0,0]
+			for t in element:
+				if t.tag == 'v1':
+					v[0] = int(t.text)
+				elif t.tag == 'v2':
+					v[1] = int(t.text)
+				elif t.tag == 'v3':
+					v[2] = int(t.text)
+			indexList.extend(v)
+		elif element.tag == 'volume':
+			if obj is not None:
+				_addVolume(obj, vertexList, indexList)
+			indexList = array.array('i')
+		elif element.tag == 'mesh':
+			vertexList = array.array('f')
+		elif element.tag == 'object':
+			obj._postProcessAfterLoad()
+			ret.append(obj)
+			obj = None
+		if element.tag in _processedTags and len(parentList) > 0:
+			parentList[-1].remove(element)
 
+	stream.close()
+	if zfile is not None:
+		zfile.close()
 	return ret
 
+_vertexTemplate = '        <vertex>\n          <coordinates>\n            <x>%f</x>\n            <y>%f</y>\n            <z>%f</z>\n          </coordinates>\n        </vertex>\n'
+_triangleTemplate = '        <triangle>\n          <v1>%i</v1>\n          <v2>%i</v2>\n          <v3>%i</v3>\n        </triangle>\n'
+_chunkSize = 10000
+
+def _writeChunked(xml, template, values):
+	#Format a large block of vertexes or triangles with a single string format operation, instead of a write per line.
+	values = values.tolist()
+	for n in xrange(0, len(values), _chunkSize * 3):
+		part = values[n:n + _chunkSize * 3]
+		xml.write((template * (len(part) / 3)) % tuple(part))
+
 def saveScene(filename, objects):
 	f = open(filename, 'wb')
 	saveSceneStream(f, filename, objects)
@@ -95,25 +140,13 @@ def saveSceneStream(s, filename, objects):
 		xml.write('    <mesh>\n')
 		xml.write('      <vertices>\n')
 		vertexList, meshList = obj.getVertexIndexList()
-		for v in vertexList:
-			xml.write('        <vertex>\n')
-			xml.write('          <coordinates>\n')
-			xml.write('            <x>%f</x>\n' % (v[0]))
-			xml.write('            <y>%f</y>\n' % (v[1]))
-			xml.write('            <z>%f</z>\n' % (v[2]))
-			xml.write('          </coordinates>\n')
-			xml.write('        </vertex>\n')
+		_writeChunked(xml, _vertexTemplate, vertexList.reshape(len(vertexList) * 3))
 		xml.write('      </vertices>\n')
 
 		matID = 1
 		for m in meshList:
 			xml.write('      <volume materialid="%i">\n' % (matID))
-			for idx in xrange(0, len(m), 3):
-				xml.write('        <triangle>\n')
-				xml.write('          <v1>%i</v1>\n' % (m[idx]))
-				xml.write('          <v2>%i</v2>\n' % (m[idx+1]))
-				xml.write('          <v3>%i</v3>\n' % (m[idx+2]))
-				xml.write('        </triangle>\n')
+			_writeChunked(xml, _triangleTemplate, m)
 			xml.write('      </volume>\n')
 			matID += 1
 		xml.write('    </mesh>\n')
@@ -2,40 +2,77 @@ from __future__ import absolute_import
 __copyright__ = "Copyright (C) 2013 David Braam - Released under terms of the AGPLv3 License"
 
 import os
+import re
+
+import numpy
+
 from Cura.util import mesh
 
+#Strips the texture and normal references from the face indexes, so "1/2/3", "1/2" and "1//3" all become "1".
+_faceIndexRegex = re.compile(r'/\S*')
+
+def _parseVertexes(vertexLines):
+	if len(vertexLines) < 1:
+		return numpy.zeros((0, 3), numpy.float32)
+	vertexes = numpy.fromstring(''.join(vertexLines), numpy.float32, sep=' ')
+	if len(vertexes) == len(vertexLines) * 3:
+		return vertexes.reshape((len(vertexLines), 3))
+	#Some exporters add a w component or a vertex colour, only use the first 3 values of every line.
+	return numpy.array(map(lambda l: map(float, (l.split() + ['0', '0', '0'])[0:3]), vertexLines), numpy.float32).reshape((len(vertexLines), 3))
+
+def _parseFaces(faceLines):
+	#Returns the flat list of (1 based or negative) vertex indexes, and the amount of indexes for each face.
+	if len(faceLines) < 1:
+		return numpy.zeros((0,), numpy.int32), numpy.zeros((0,), numpy.int32)
+	indexes = numpy.fromstring(_faceIndexRegex.sub('', ''.join(faceLines)), numpy.int32, sep=' ')
+	#The indexes are counted for each line, a matching total alone does not mean that every face is a triangle.
+	counts = numpy.array(map(lambda l: len(l.split()), faceLines), numpy.int32)
+	if numpy.sum(counts) != len(indexes):
+		indexes = numpy.array(map(lambda p: int(p.split('/')[0]), ' '.join(faceLines).split()), numpy.int32)
+	return indexes, counts
+
 def loadScene(filename):
 	obj = mesh.printableObject(filename)
 	m = obj._addMesh()
 
-	vertexList = []
-	faceList = []
+	vertexLines = []
+	faceLines = []
+	faceVertexCount = []
 
 	f = open(filename, "r")
 	for line in f:
-		parts = line.split()
-		if len(parts) < 1:
-			continue
-		if parts[0] == 'v':
-			vertexList.append([float(parts[1]), float(parts[2]), float(parts[3])])
-		if parts[0] == 'f':
-			parts = map(lambda p: p.split('/')[0], parts)
-			for idx in xrange(1, len(parts)-2):
-				faceList.append([int(parts[1]), int(parts[idx+1]), int(parts[idx+2])])
+		if line[0:1].isspace():
+			line = line.lstrip()
+		if line[0:2] == 'v ' or line[0:2] == 'v\t':
+			vertexLines.append(line[2:])
+		elif line[0:2] == 'f ' or line[0:2] == 'f\t':
+			faceLines.append(line[2:])
+			#Negative indexes are relative to the amount of vertexes defined before the face.
+			faceVertexCount.append(len(vertexLines))
 	f.close()
 
-	m._prepareFaceCount(len(faceList))
-	for f in faceList:
-		i = f[0] - 1
-		j = f[1] - 1
-		k = f[2] - 1
-		if i < 0 or i >= len(vertexList):
-			i = 0
-		if j < 0 or j >= len(vertexList):
-			j = 0
-		if k < 0 or k >= len(vertexList):
-			k = 0
-		m._addFace(vertexList[i][0], vertexList[i][1], vertexList[i][2], vertexList[j][0], vertexList[j][1], vertexList[j][2], vertexList[k][0], vertexList[k][1], vertexList[k][2])
+	vertexes = _parseVertexes(vertexLines)
+	if len(vertexes) < 1:
+		faceLines = []
+		faceVertexCount = []
+	indexes, counts = _parseFaces(faceLines)
+
+	indexes = numpy.where(indexes < 0, indexes + numpy.repeat(numpy.array(faceVertexCount, numpy.int32), counts), indexes - 1)
+	indexes[(indexes < 0) | (indexes >= len(vertexes))] = 0
+
+	#Fan triangulate all polygons at once, a polygon with N indexes becomes N-2 triangles (0,k+1,k+2).
+	triCounts = numpy.maximum(counts - 2, 0)
+	faceCount = int(numpy.sum(triCounts))
+	first = numpy.repeat(numpy.cumsum(counts) - counts, triCounts)
+	fan = numpy.arange(faceCount) - numpy.repeat(numpy.cumsum(triCounts) - triCounts, triCounts)
+	triangles = numpy.zeros((faceCount, 3), numpy.int32)
+	triangles[::,0] = indexes[first]
+	triangles[::,1] = indexes[first + fan + 1]
+	triangles[::,2] = indexes[first + fan + 2]
+
+	m._prepareFaceCount(faceCount)
+	numpy.take(vertexes, triangles.reshape(faceCount * 3), axis=0, out=m.vertexes)
+	m.vertexCount = faceCount * 3
 
 	obj._postProcessAfterLoad()
 	return [obj]
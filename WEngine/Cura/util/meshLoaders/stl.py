@@ -3,52 +3,120 @@ __copyright__ = "Copyright (C) 2013 David Braam - Released under terms of the AG
 
 import sys
 import os
+import re
 import struct
 import time
 
+import numpy
+
 from Cura.util import mesh
 
-def _loadAscii(m, f):
-	cnt = 0
-	for lines in f:
-		for line in lines.split('\r'):
-			if 'vertex' in line:
-				cnt += 1
-	m._prepareFaceCount(int(cnt) / 3)
-	f.seek(5, os.SEEK_SET)
-	cnt = 0
-	data = [None,None,None]
-	for lines in f:
-		for line in lines.split('\r'):
-			if 'vertex' in line:
-				data[cnt] = line.split()[1:]
-				cnt += 1
-				if cnt == 3:
-					m._addFace(float(data[0][0]), float(data[0][1]), float(data[0][2]), float(data[1][0]), float(data[1][1]), float(data[1][2]), float(data[2][0]), float(data[2][1]), float(data[2][2]))
-					cnt = 0
-
-def _loadBinary(m, f):
+#Binary STL face record: normal, 3 vertexes and the attribute byte count, packed into 50 bytes.
+_binaryFaceType = numpy.dtype([('normal', '<f4', (3,)), ('vertexes', '<f4', (9,)), ('attribute', '<u2')])
+_asciiVertexRegex = re.compile(r'vertex\s+(\S+\s+\S+\s+\S+)')
+_asciiChunkSize = 16 * 1024 * 1024
+_progressFaceCount = 50000
+
+class _loadAborted(Exception):
+	pass
+
+def _copyFaces(m, faces, callback):
+	#Copy the vertexes of the face records into the mesh in blocks. After each block the callback gets the progress
+	# and the partially filled mesh, so the caller can show it while loading. Returning True from the callback aborts the load.
+	faceCount = len(faces)
+	m._prepareFaceCount(faceCount)
+	vertexes = m.vertexes.reshape(faceCount, 9)
+	for n in xrange(0, faceCount, _progressFaceCount):
+		end = min(n + _progressFaceCount, faceCount)
+		vertexes[n:end] = faces['vertexes'][n:end]
+		m.vertexCount = end * 3
+		if callback is not None and callback(float(end) / float(faceCount), m):
+			raise _loadAborted()
+
+def _parseAsciiChunk(data):
+	#Convert all the "vertex x y z" triples in a block of text with a single numpy parse call.
+	vertexList = _asciiVertexRegex.findall(data)
+	if len(vertexList) < 1:
+		return numpy.zeros((0,), numpy.float32)
+	values = numpy.fromstring(' '.join(vertexList), numpy.float32, sep=' ')
+	if len(values) != len(vertexList) * 3:
+		values = numpy.array(map(float, ' '.join(vertexList).split()), numpy.float32)
+	return values
+
+def _loadAscii(m, f, callback):
+	#Read the file in newline aligned chunks and parse each chunk on its own, so the file is only scanned once.
+	# The regular expression handles \r, \n and \r\n line endings alike.
+	chunkList = []
+	rest = ''
+	fileSize = os.fstat(f.fileno()).st_size
+	while True:
+		data = f.read(_asciiChunkSize)
+		if not data:
+			break
+		data = rest + data
+		split = max(data.rfind('\n'), data.rfind('\r')) + 1
+		rest = data[split:]
+		chunkList.append(_parseAsciiChunk(data[:split]))
+		if callback is not None and callback(float(f.tell()) / float(max(fileSize, 1)), None):
+			raise _loadAborted()
+	chunkList.append(_parseAsciiChunk(rest))
+
+	faceCount = sum(map(len, chunkList)) / 9
+	m._prepareFaceCount(faceCount)
+	values = m.vertexes.reshape(faceCount * 9)
+	offset = 0
+	for chunk in chunkList:
+		size = min(len(chunk), len(values) - offset)
+		values[offset:offset+size] = chunk[0:size]
+		offset += size
+	m.vertexCount = faceCount * 3
+
+def _loadBinary(m, f, callback):
 	#Skip the header
 	f.read(80-5)
 	faceCount = struct.unpack('<I', f.read(4))[0]
-	m._prepareFaceCount(faceCount)
-	for idx in xrange(0, faceCount):
-		data = struct.unpack("<ffffffffffffH", f.read(50))
-		m._addFace(data[3], data[4], data[5], data[6], data[7], data[8], data[9], data[10], data[11])
+	#Parse all face records in one go, only the vertex fields are copied into the mesh.
+	data = f.read(faceCount * _binaryFaceType.itemsize)
+	faceCount = len(data) / _binaryFaceType.itemsize
+	_copyFaces(m, numpy.frombuffer(data, _binaryFaceType, faceCount), callback)
 
-def loadScene(filename):
+def _loadBinaryMapped(m, f, filename, callback):
+	#Map the face records straight from the file instead of reading them into a string first.
+	# This way the vertexes are only copied once, into the mesh, and the peak memory stays close to the file size.
+	f.read(80-5)
+	faceCount = struct.unpack('<I', f.read(4))[0]
+	faceCount = min(faceCount, (os.path.getsize(filename) - 84) / _binaryFaceType.itemsize)
+	if faceCount < 1:
+		return False
+	try:
+		faces = numpy.memmap(filename, _binaryFaceType, 'r', 84, (faceCount,))
+	except (EnvironmentError, ValueError):
+		return False
+	try:
+		_copyFaces(m, faces, callback)
+	finally:
+		del faces
+	return True
+
+def loadScene(filename, callback = None):
 	obj = mesh.printableObject(filename)
 	m = obj._addMesh()
 
 	f = open(filename, "rb")
-	if f.read(5).lower() == "solid":
-		_loadAscii(m, f)
-		if m.vertexCount < 3:
+	try:
+		if f.read(5).lower() == "solid":
+			_loadAscii(m, f, callback)
+			if m.vertexCount < 3:
+				f.seek(5, os.SEEK_SET)
+				_loadBinary(m, f, callback)
+		elif not _loadBinaryMapped(m, f, filename, callback):
 			f.seek(5, os.SEEK_SET)
-			_loadBinary(m, f)
-	else:
-		_loadBinary(m, f)
-	f.close()
+			_loadBinary(m, f, callback)
+	except _loadAborted:
+		#The results of an aborted load are discarded.
+		return []
+	finally:
+		f.close()
 	obj._postProcessAfterLoad()
 	return [obj]
 
@@ -67,16 +135,16 @@ def saveSceneStream(stream, objects):
 			vertexCount += m.vertexCount
 
 	#Next follow 4 binary bytes containing the amount of faces, and then the face information.
+	# The face records of each mesh are build as a single record array and written in one go.
 	stream.write(struct.pack("<I", int(vertexCount / 3)))
 	for obj in objects:
 		for m in obj._meshList:
-			vertexes = m.getTransformedVertexes(True)
-			for idx in xrange(0, m.vertexCount, 3):
-				v1 = vertexes[idx]
-				v2 = vertexes[idx+1]
-				v3 = vertexes[idx+2]
-				stream.write(struct.pack("<fff", 0.0, 0.0, 0.0))
-				stream.write(struct.pack("<fff", v1[0], v1[1], v1[2]))
-				stream.write(struct.pack("<fff", v2[0], v2[1], v2[2]))
-				stream.write(struct.pack("<fff", v3[0], v3[1], v3[2]))
-				stream.write(struct.pack("<H", 0))
+			faceCount = m.vertexCount / 3
+			vertexes = m.getTransformedVertexes(True).reshape((faceCount, 3, 3))
+			normals = numpy.cross(vertexes[::,1] - vertexes[::,0], vertexes[::,2] - vertexes[::,0])
+			lens = numpy.sqrt(numpy.sum(normals * normals, 1))
+			lens[lens == 0] = 1
+			faces = numpy.zeros((faceCount,), _binaryFaceType)
+			faces['normal'] = normals / lens.reshape((faceCount, 1))
+			faces['vertexes'] = vertexes.reshape((faceCount, 9))
+			stream.write(faces.tostring())
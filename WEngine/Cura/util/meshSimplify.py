@@ -0,0 +1,129 @@
+from __future__ import absolute_import
+__copyright__ = "Copyright (C) 2013 David Braam - Released under terms of the AGPLv3 License"
+
+import numpy
+
+from Cura.util import meshKernels
+
+#simplifyMesh reduces an indexed mesh to about the given amount of faces with quadric edge collapse.
+#Every vertex gets the quadric of the planes of its faces (weighted with the face area), the cost of collapsing an edge is
+# the quadric error of the merged vertex at the best of the 2 end points and the middle of the edge.
+#Instead of collapsing one edge at a time from a priority queue, each round collapses a batch of the cheapest edges that do
+# not share a vertex, so all the work is done on whole arrays. Collapses that would flip a face are skipped, and vertexes
+# on an open border are never moved, so holes in the mesh do not grow.
+#Returns the new unique vertexes (float32) and the flat triangle index list (intp).
+def simplifyMesh(vertexes, indexes, targetFaceCount, maxRounds = 50):
+	vertexes = numpy.array(vertexes, numpy.float64)
+	faces = numpy.asarray(indexes, numpy.int64)
+	faces = faces[0:len(faces) - len(faces) % 3].reshape((len(faces) / 3, 3))
+	vertexCount = len(vertexes)
+
+	for n in xrange(0, maxRounds):
+		faceCount = len(faces)
+		if faceCount <= targetFaceCount or faceCount < 1:
+			break
+		quadrics = _vertexQuadrics(vertexes, faces)
+
+		#All unique edges, with the amount of faces that use them.
+		u = numpy.concatenate((faces[::,0], faces[::,1], faces[::,2]))
+		v = numpy.concatenate((faces[::,1], faces[::,2], faces[::,0]))
+		keys, inverse = numpy.unique(numpy.minimum(u, v) * vertexCount + numpy.maximum(u, v), return_inverse=True)
+		edgeUse = numpy.bincount(inverse)
+		low = keys / vertexCount
+		high = keys % vertexCount
+		locked = numpy.zeros((vertexCount,), numpy.bool)
+		locked[low[edgeUse == 1]] = True
+		locked[high[edgeUse == 1]] = True
+		free = ~(locked[low] | locked[high])
+		low = low[free]
+		high = high[free]
+		if len(low) < 1:
+			break
+
+		#Cost and best position of each collapse, only the cheapest edges are candidates for this round.
+		q = quadrics[low] + quadrics[high]
+		positions = numpy.array([vertexes[low], vertexes[high], (vertexes[low] + vertexes[high]) / 2])
+		costs = numpy.array([_quadricError(q, positions[0]), _quadricError(q, positions[1]), _quadricError(q, positions[2])])
+		best = numpy.argmin(costs, 0)
+		edgeIndex = numpy.arange(0, len(low))
+		position = positions[best, edgeIndex]
+		cost = costs[best, edgeIndex]
+		limit = max(1, min((faceCount - targetFaceCount) / 2 + 1, len(low) / 4))
+		order = numpy.argsort(cost)[0:limit]
+		low = low[order]
+		high = high[order]
+		position = position[order]
+
+		#Take an edge when it is the cheapest candidate on both of its vertexes, so no vertex is part of 2 collapses.
+		rank = numpy.arange(0, len(low))
+		ends = numpy.concatenate((low, high))
+		endRank = numpy.concatenate((rank, rank))
+		endOrder = numpy.lexsort((endRank, ends))
+		ends = ends[endOrder]
+		endRank = endRank[endOrder]
+		first = numpy.ones((len(ends),), numpy.bool)
+		first[1:] = ends[1:] != ends[:-1]
+		vertexBest = numpy.zeros((vertexCount,), numpy.int64) - 1
+		vertexBest[ends[first]] = endRank[first]
+		selected = (vertexBest[low] == rank) & (vertexBest[high] == rank)
+		low = low[selected]
+		high = high[selected]
+		position = position[selected]
+
+		#Skip the collapses that flip a face around them.
+		moved = numpy.zeros((vertexCount,), numpy.int64) - 1
+		moved[low] = numpy.arange(0, len(low))
+		moved[high] = numpy.arange(0, len(low))
+		remap = numpy.arange(0, vertexCount)
+		remap[high] = low
+		newVertexes = vertexes.copy()
+		newVertexes[low] = position
+		touched = numpy.any(moved[faces] >= 0, 1)
+		oldFaces = faces[touched]
+		newFaces = remap[oldFaces]
+		alive = (newFaces[::,0] != newFaces[::,1]) & (newFaces[::,1] != newFaces[::,2]) & (newFaces[::,2] != newFaces[::,0])
+		oldNormals, oldLens = meshKernels.faceNormals(vertexes[oldFaces[alive]])
+		newNormals = meshKernels.faceNormals(newVertexes[newFaces[alive]])[0]
+		flipped = oldFaces[alive][(numpy.einsum('ij,ij->i', oldNormals, newNormals) < 0.2) & (oldLens > 0)]
+		reject = numpy.zeros((len(low),), numpy.bool)
+		flippedMoves = moved[flipped.reshape(flipped.size)]
+		reject[flippedMoves[flippedMoves >= 0]] = True
+		low = low[~reject]
+		high = high[~reject]
+		if len(low) < 1:
+			break
+
+		remap = numpy.arange(0, vertexCount)
+		remap[high] = low
+		vertexes[low] = position[~reject]
+		faces = remap[faces]
+		faces = faces[(faces[::,0] != faces[::,1]) & (faces[::,1] != faces[::,2]) & (faces[::,2] != faces[::,0])]
+
+	#Only keep the vertexes that are still used.
+	used = numpy.unique(faces.reshape(faces.size))
+	newIndex = numpy.zeros((vertexCount,), numpy.int64)
+	newIndex[used] = numpy.arange(0, len(used))
+	return numpy.array(vertexes[used], numpy.float32), numpy.array(newIndex[faces].reshape(faces.size), numpy.intp)
+
+def _vertexQuadrics(vertexes, faces):
+	#The 10 unique values of the symmetric 4x4 plane quadric (aa ab ac ad bb bc bd cc cd dd), summed for each vertex.
+	tris = vertexes[faces]
+	normals, lens = meshKernels.faceNormals(tris)
+	a = normals[::,0]
+	b = normals[::,1]
+	c = normals[::,2]
+	d = -numpy.einsum('ij,ij->i', normals, tris[::,0])
+	weight = lens / 2
+	values = [a*a, a*b, a*c, a*d, b*b, b*c, b*d, c*c, c*d, d*d]
+	#The faces are int64 for the edge keys, but bincount only takes intp indexes on the 32 bit runtime.
+	flat = faces.reshape(faces.size).astype(numpy.intp)
+	quadrics = numpy.zeros((len(vertexes), 10), numpy.float64)
+	for n in xrange(0, 10):
+		quadrics[::,n] = numpy.bincount(flat, numpy.repeat(values[n] * weight, 3), len(vertexes))
+	return quadrics
+
+def _quadricError(q, p):
+	x = p[::,0]
+	y = p[::,1]
+	z = p[::,2]
+	return q[::,0]*x*x + 2*q[::,1]*x*y + 2*q[::,2]*x*z + 2*q[::,3]*x + q[::,4]*y*y + 2*q[::,5]*y*z + 2*q[::,6]*y + q[::,7]*z*z + 2*q[::,8]*z + q[::,9]
@@ -2,12 +2,14 @@ __copenglyright__ = "Copyright (C) 2013 David Braam - Released under terms of th
 import random
 import numpy
 from Cura.util import profile
-
-class _objectOrder(object):
-	def __init__(self, order, todo):
-		self.order = order
-		self.todo = todo
-
+from Cura.util import convexHull
+
+#_objectOrderFinder finds the order to print the objects one at a time, so the head never hits an object that is already printed.
+#_hitMap[a][b] is True when printing a would hit b if b was already printed, so a has to be printed before b. These are the
+# edges of a precedence graph, and any topological order of that graph is a valid print order. The order is build by
+# repeatedly taking an object of which all objects that have to go before it are printed. The sets of objects are kept as
+# bits of an integer, so each check is a single and operation. 2 objects that hit each other can never be printed
+# one at a time, which is checked first. If the graph has a longer cycle the order stops early, in both cases the order is None.
 class _objectOrderFinder(object):
 	def __init__(self, scene, offset, leftToRight, frontToBack, gantryHeight):
 		self._scene = scene
@@ -27,72 +29,110 @@ class _objectOrderFinder(object):
 			self.order = []
 			return
 
+		self._hitMap = self._buildHitMap(initialList)
+		count = len(initialList)
+		if numpy.any(self._hitMap & self._hitMap.T):
+			self.order = None
+			return
 
-		self._hitMap = [None] * (max(initialList)+1)
-		for a in initialList:
-			self._hitMap[a] = [False] * (max(initialList)+1)
-			for b in initialList:
-				self._hitMap[a][b] = self._checkHit(a, b)
-
-		initialList.sort(self._objIdxCmp)
-
-		n = 0
-		self._todo = [_objectOrder([], initialList)]
-		while len(self._todo) > 0:
-			n += 1
-			current = self._todo.pop()
-			#print len(self._todo), len(current.order), len(initialList), current.order
-			for addIdx in current.todo:
-				if not self._checkHitFor(addIdx, current.order) and not self._checkBlocks(addIdx, current.todo):
-					todoList = current.todo[:]
-					todoList.remove(addIdx)
-					order = current.order[:] + [addIdx]
-					if len(todoList) == 0:
-						self._todo = None
-						self.order = order
-						return
-					self._todo.append(_objectOrder(order, todoList))
-		self.order = None
-
-	def _objIdxCmp(self, a, b):
-		scoreA = sum(self._hitMap[a])
-		scoreB = sum(self._hitMap[b])
-		return scoreA - scoreB
-
-	def _checkHitFor(self, addIdx, others):
-		for idx in others:
-			if self._hitMap[addIdx][idx]:
-				return True
-		return False
-
-	def _checkBlocks(self, addIdx, others):
-		for idx in others:
-			if addIdx != idx and self._hitMap[idx][addIdx]:
-				return True
-		return False
-
-	#Check if printing one object will cause printhead colission with other object.
-	def _checkHit(self, addIdx, idx):
-		addPos = self._scene._objectList[addIdx].getPosition()
-		addSize = self._scene._objectList[addIdx].getSize()
-		pos = self._scene._objectList[idx].getPosition()
-		size = self._scene._objectList[idx].getSize()
+		#before[n] holds the bits of the objects that have to be printed before object n.
+		before = [0] * count
+		for a, b in zip(*numpy.nonzero(self._hitMap)):
+			before[b] |= 1 << int(a)
+		#Objects that have to go before many others are taken first when there is a choice.
+		priority = sorted(xrange(0, count), key=lambda n: -int(numpy.sum(self._hitMap[n])))
+		todo = (1 << count) - 1
+		order = []
+		while todo != 0:
+			for n in priority:
+				if todo & (1 << n) and before[n] & todo == 0:
+					break
+			else:
+				self.order = None
+				return
+			todo &= ~(1 << n)
+			order.append(initialList[n])
+		self.order = order
 
+	#Check for all pairs of objects if printing the first will cause a printhead collision with the second.
+	def _buildHitMap(self, indexList):
+		pos = numpy.array(map(lambda n: self._objs[n].getPosition()[0:2], indexList), numpy.float64)
+		size = numpy.array(map(lambda n: self._objs[n].getSize()[0:2], indexList), numpy.float64)
+		low = pos - size / 2
+		high = pos + size / 2
 		if self._leftToRight:
-			if addPos[0] - addSize[0] / 2 - self._offset[0] >= pos[0] + size[0] / 2:
-				return False
+			freeX = (low[::,0] - self._offset[0]).reshape((len(pos), 1)) >= high[::,0]
 		else:
-			if addPos[0] + addSize[0] / 2 + self._offset[0] <= pos[0] - size[0] / 2:
-				return False
-
+			freeX = (high[::,0] + self._offset[0]).reshape((len(pos), 1)) <= low[::,0]
 		if self._frontToBack:
-			if addPos[1] - addSize[1] / 2 - self._offset[1] >= pos[1] + size[1] / 2:
-				return False
+			freeY = (low[::,1] - self._offset[1]).reshape((len(pos), 1)) >= high[::,1]
 		else:
-			if addPos[1] + addSize[1] / 2 + self._offset[1] <= pos[1] - size[1] / 2:
-				return False
-
-		return True
+			freeY = (high[::,1] + self._offset[1]).reshape((len(pos), 1)) <= low[::,1]
+		hitMap = ~(freeX | freeY)
+		numpy.fill_diagonal(hitMap, False)
+		return hitMap
+
+#_skylinePacker places rectangles on a rectangular area, bottom-left first. The area that is filled is kept as a skyline:
+# a list of [x, y, width] segments from left to right, giving the height of the filled area at each position.
+# A rectangle is placed on the segment where its top ends lowest, rectangles are never placed below the skyline.
+class _skylinePacker(object):
+	def __init__(self, width, height):
+		self._width = width
+		self._height = height
+		self._skyline = [[0.0, 0.0, width]]
+
+	def insert(self, width, height):
+		#Returns the lower left corner of the placed rectangle, or None if it does not fit.
+		best = None
+		for index in xrange(0, len(self._skyline)):
+			y = self._fit(index, width, height)
+			if y is None:
+				continue
+			x = self._skyline[index][0]
+			if best is None or y + height < best[0] - 0.0001 or (y + height < best[0] + 0.0001 and x < best[1]):
+				best = (y + height, x, y, index)
+		if best is None:
+			return None
+		self._addLevel(best[3], best[1], best[2], width, height)
+		return best[1], best[2]
+
+	def _fit(self, index, width, height):
+		#The height at which the rectangle fits with its left side at the start of the segment, or None.
+		x = self._skyline[index][0]
+		if x + width > self._width + 0.0001:
+			return None
+		y = 0.0
+		widthLeft = width
+		while widthLeft > 0.0001 and index < len(self._skyline):
+			y = max(y, self._skyline[index][1])
+			if y + height > self._height + 0.0001:
+				return None
+			widthLeft -= self._skyline[index][2]
+			index += 1
+		return y
+
+	def _addLevel(self, index, x, y, width, height):
+		self._skyline.insert(index, [x, y + height, width])
+		#Cut the segments that are now below the new segment.
+		index += 1
+		while index < len(self._skyline):
+			end = self._skyline[index - 1][0] + self._skyline[index - 1][2]
+			if self._skyline[index][0] >= end - 0.0001:
+				break
+			shrink = end - self._skyline[index][0]
+			self._skyline[index][0] += shrink
+			self._skyline[index][2] -= shrink
+			if self._skyline[index][2] > 0.0001:
+				break
+			del self._skyline[index]
+		#Merge neighbours at the same height.
+		index = 0
+		while index < len(self._skyline) - 1:
+			if abs(self._skyline[index][1] - self._skyline[index + 1][1]) < 0.0001:
+				self._skyline[index][2] += self._skyline[index + 1][2]
+				del self._skyline[index + 1]
+			else:
+				index += 1
 
 class Scene(object):
 	def __init__(self):
@@ -104,7 +144,6 @@ class Scene(object):
 		self._leftToRight = False
 		self._frontToBack = True
 		self._gantryHeight = 60
-		self._isCallFromScale = False
 		#self._debug=0
 	# Physical (square) machine size.
 	def setMachineSize(self, machineSize):
@@ -130,6 +169,11 @@ class Scene(object):
 
 	#Add new object to print area
 	def add(self, obj):
+		if obj.getSchematic() is True:
+			#Schematic objects are not placed free of the others, they are placed on the object they are attached to.
+			self._objectList.append(obj)
+			self.attachSchematic(obj)
+			return
 		self._findFreePositionFor(obj)
 		self._objectList.append(obj)
 		self.pushFree()
@@ -140,15 +184,34 @@ class Scene(object):
 
 	def remove(self, obj):
 		self._objectList.remove(obj)
+		obj.detach()
+		for child in obj.getChildren()[:]:
+			child.detach()
+
+	#Attach a schematic object to the object it is placed on. When it is not on an object, it goes back on its old host,
+	# or on the nearest object when it had no host yet.
+	def attachSchematic(self, obj):
+		hostList = filter(lambda o: o.getSchematic() is not True, self._objectList)
+		for host in hostList:
+			if self._checkHit(obj, host):
+				obj.attachTo(host)
+				return
+		if obj.getHost() is not None:
+			obj.updateFromHost()
+		elif len(hostList) > 0:
+			obj.attachTo(min(hostList, key=lambda host: numpy.sum((host.getPosition() - obj.getPosition()) ** 2)), True)
 
 	#Dual(multiple) extrusion merge
 	def merge(self, obj1, obj2):
+		children = obj2.getChildren()[:]
 		self.remove(obj2)
 		obj1._meshList += obj2._meshList
 		for m in obj2._meshList:
 			m._obj = obj1
 		obj1.processMatrix()
 		obj1.setPosition((obj1.getPosition() + obj2.getPosition()) / 2)
+		for child in children:
+			child.attachTo(obj1)
 		self.pushFree()
 
 	def pushFree(self):
@@ -159,11 +222,56 @@ class Scene(object):
 				return
 
 	def arrangeAll(self):
-		oldList = self._objectList
-		self._objectList = []
-		for obj in oldList:
-			obj.setPosition(numpy.array([0,0], numpy.float32))
-			self.add(obj)
+		self._arrange()
+
+	#Add a list of objects, and arrange the whole scene. Returns the added objects that did not fit on the platform.
+	def addArranged(self, objList):
+		self._objectList += objList
+		failed = self._arrange()
+		return filter(lambda obj: obj in failed, objList)
+
+	def _arrange(self):
+		#Pack all objects on the platform, objects that do not fit are placed next to the others like a normal add.
+		# Schematic objects are not packed, they follow the object they are placed on.
+		failed = self._packObjects(filter(lambda obj: obj.getSchematic() is not True, self._objectList))
+		for obj in failed:
+			self._objectList.remove(obj)
+			self._findFreePositionFor(obj)
+			self._objectList.append(obj)
+		self.pushFree()
+		return failed
+
+	def _packObjects(self, objList, allowRotate = True):
+		#Every object gets a rectangle of its size plus the size and head offsets, two rectangles that touch are just far
+		# enough apart to not hit. The packing area is the platform, grown so the offsets of the outer objects may stick out.
+		# The largest objects are placed first. An object is only turned by 90 degrees when it does not fit otherwise.
+		# Returns the objects that did not fit.
+		extend = self._sizeOffsets + self._headOffsets + 0.1
+		area = self._machineSize[0:2] - self._sizeOffsets + self._headOffsets + 0.1
+		packer = _skylinePacker(area[0], area[1])
+		placed = []
+		failed = []
+		for obj in sorted(objList, key=lambda obj: -numpy.max(obj.getSize()[0:2])):
+			size = obj.getSize()[0:2] + extend
+			pos = packer.insert(size[0], size[1])
+			if pos is None and allowRotate and abs(size[0] - size[1]) > 0.1:
+				pos = packer.insert(size[1], size[0])
+				if pos is not None:
+					obj.applyMatrix(numpy.matrix([[0,-1,0],[1,0,0],[0,0,1]], numpy.float64))
+					size = size[::-1]
+			if pos is None:
+				failed.append(obj)
+				continue
+			placed.append((obj, pos[0] + size[0] / 2, pos[1] + size[1] / 2, pos[0] + size[0], pos[1] + size[1]))
+		if len(placed) < 1:
+			return failed
+
+		#Center the packed objects on the platform.
+		offsetX = -max(map(lambda p: p[3], placed)) / 2
+		offsetY = -max(map(lambda p: p[4], placed)) / 2
+		for obj, x, y, right, top in placed:
+			obj.setPosition(numpy.array([x + offsetX, y + offsetY], numpy.float32))
+		return failed
 
 	def centerAll(self):
 		minPos = numpy.array([9999999,9999999], numpy.float32)
@@ -177,132 +285,76 @@ class Scene(object):
 			maxPos[1] = max(maxPos[1], pos[1] + size[1] / 2)
 		offset = -(maxPos + minPos) / 2
 		for obj in self._objectList:
-			obj.setPosition(obj.getPosition() + offset)
+			if obj.getHost() is None:
+				obj.setPosition(obj.getPosition() + offset)
 
 	def printOrder(self):
 		order = _objectOrderFinder(self, self._headOffsets + self._sizeOffsets, self._leftToRight, self._frontToBack, self._gantryHeight).order
 		return order
 
+	#_pushFree moves the overlapping objects apart, it returns True when something was moved so pushFree calls it again.
+	#Only the pairs of objects that overlap on the X axis are candidates, these are found with a sweep over the objects sorted
+	# on their left side (sweep-and-prune). All candidate pairs are resolved in a single pass, so a call is about linear in
+	# the amount of objects instead of checking all pairs for a single fix.
+	#Schematic objects are not pushed, they are moved with the object they are attached to.
 	def _pushFree(self):
-		for a in self._objectList:
-			for b in self._objectList:
-
-				if(a==b):
-					continue
-
-				if not self._checkHit(a, b):		#no hit but schematic
-					if a.getSchematic() is True:	
-						#rel pos				
-						# tempX = b.getPosition()[0] + a.getRelativeX()
-						# tempY = b.getPosition()[1] + a.getRelativeY()
-						tempX = a.getRelativeX()*(b.getSize()[0]/2) + b.getPosition()[0]
-						tempY = a.getRelativeY()*(b.getSize()[1]/2) + b.getPosition()[1]
-						a.setPosition(numpy.array([tempX,tempY], numpy.float32))
-						a._noHitCnt +=1
-						
-						
-						# a.setPosition(b.getPosition())
-						#a.setDrawOffset(numpy.array([0,0,-b.getSize()[2]], numpy.float32))		
-										
-						continue
-					if b.getSchematic() is True:
-							
-						#rel pos				
-						# tempX = a.getPosition()[0] + b.getRelativeX()
-						# tempY = a.getPosition()[1] + b.getRelativeY() 
-						tempX = b.getRelativeX()*(a.getSize()[0]/2) + a.getPosition()[0]
-						tempY = b.getRelativeY()*(a.getSize()[1]/2) + a.getPosition()[1]
-						b.setPosition(numpy.array([tempX,tempY], numpy.float32))
-						b._noHitCnt +=1
-						
-						
-						# b.setPosition(a.getPosition())
-						#b.setDrawOffset(numpy.array([0,0,-a.getSize()[2]], numpy.float32))	
-										
-						continue
-					isContinue = True
-					continue
-				elif a.getSchematic() is True:			#hit and A is schematic
-					
-					#rel pos
-					# a.setRelativeX(a.getPosition()[0] - b.getPosition()[0])
-					# a.setRelativeY(a.getPosition()[1] - b.getPosition()[1])	
-
-					#debug
-					# b._debug = self._debug
-
-					# error : its call after scaleset and move LED 	
-					if self._isCallFromScale is True:
-						# self._debug +=100
-						#set position x,y
-						tempX = a.getRelativeX()*(b.getSize()[0]/2) + b.getPosition()[0]
-						tempY = a.getRelativeY()*(b.getSize()[1]/2) + b.getPosition()[1]
-						a.setPosition(numpy.array([tempX,tempY], numpy.float32))										
-						_isCallFromScale = False
-					
-					a.setDrawOffset(numpy.array([0,0,-b.getSize()[2]-a.getRelativeZ()], numpy.float32))
-
-					a.setRelativeX((a.getPosition()[0]-b.getPosition()[0])*2/b.getSize()[0])
-					a.setRelativeY((a.getPosition()[1]-b.getPosition()[1])*2/b.getSize()[1])
-
-					a._HitCnt+=1
-
-					continue
-				elif b.getSchematic() is True:			#hit and B is schematic
-
-					#rel pos
-					# b.setRelativeX(b.getPosition()[0] - a.getPosition()[0])
-					# b.setRelativeY(b.getPosition()[1] - a.getPosition()[1])		
-						
-					#debug
-					# a._debug = self._debug
-					if self._isCallFromScale is True:	
-						# self._debug +=100
-						tempX = b.getRelativeX()*(a.getSize()[0]/2) + a.getPosition()[0]
-						tempY = b.getRelativeY()*(a.getSize()[1]/2) + a.getPosition()[1]
-						b.setPosition(numpy.array([tempX,tempY], numpy.float32))							
-						_isCallFromScale = False
-						
-					b.setDrawOffset(numpy.array([0,0,-a.getSize()[2]-b.getRelativeZ()], numpy.float32))
-
-					b.setRelativeX((b.getPosition()[0]-a.getPosition()[0])*2/a.getSize()[0])
-					b.setRelativeY((b.getPosition()[1]-a.getPosition()[1])*2/a.getSize()[1])
-
-					b._HitCnt+=1
-					continue
-				# a._noHitCnt+=100
-				# b._noHitCnt+=100
-				posDiff = a.getPosition() - b.getPosition()
-				if posDiff[0] == 0.0 and posDiff[1] == 0.0:
-					posDiff[1] = 1.0
-				if abs(posDiff[0]) > abs(posDiff[1]):
-					axis = 0
-				else:
-					axis = 1
-				aPos = a.getPosition()
-				bPos = b.getPosition()
-				center = (aPos[axis] + bPos[axis]) / 2
-				distance = (a.getSize()[axis] + b.getSize()[axis]) / 2 + 0.1 + self._sizeOffsets[axis] + self._headOffsets[axis]
-				if posDiff[axis] < 0:
-					distance = -distance
-				aPos[axis] = center + distance / 2
-				bPos[axis] = center - distance / 2
-				a.setPosition(aPos)
-				b.setPosition(bPos)
-
-
-				return True
-		return False
+		moved = False
+		for a, b in self._findOverlapCandidates(filter(lambda obj: obj.getSchematic() is not True, self._objectList)):
+			if not self._checkHit(a, b):
+				continue
+			posDiff = a.getPosition() - b.getPosition()
+			if posDiff[0] == 0.0 and posDiff[1] == 0.0:
+				posDiff[1] = 1.0
+			if abs(posDiff[0]) > abs(posDiff[1]):
+				axis = 0
+			else:
+				axis = 1
+			aPos = a.getPosition()
+			bPos = b.getPosition()
+			center = (aPos[axis] + bPos[axis]) / 2
+			distance = (a.getSize()[axis] + b.getSize()[axis]) / 2 + 0.1 + self._sizeOffsets[axis] + self._headOffsets[axis]
+			if posDiff[axis] < 0:
+				distance = -distance
+			aPos[axis] = center + distance / 2
+			bPos[axis] = center - distance / 2
+			a.setPosition(aPos)
+			b.setPosition(bPos)
+			moved = True
+		return moved
+
+	def _findOverlapCandidates(self, objList):
+		#Returns the pairs of objects of which the X extents (including the head space) overlap.
+		extend = (self._sizeOffsets[0] + self._headOffsets[0]) / 2
+		intervals = []
+		for obj in objList:
+			halfSize = obj.getSize()[0] / 2 + extend
+			intervals.append((obj.getPosition()[0] - halfSize, obj.getPosition()[0] + halfSize, obj))
+		intervals.sort(key=lambda interval: interval[0])
+		pairs = []
+		active = []
+		for low, high, obj in intervals:
+			active = filter(lambda interval: interval[1] > low, active)
+			for interval in active:
+				pairs.append((interval[2], obj))
+			active.append((low, high, obj))
+		return pairs
 
 	#Check if two objects are hitting each-other (+ head space).
+	#The bounding boxes are checked first, when those overlap the convex footprints of the objects are checked, with the
+	# footprint of a grown by the head space.
 	def _checkHit(self, a, b):
 		if a == b:
 			return False
 		posDiff = a.getPosition() - b.getPosition()
-		if abs(posDiff[0]) < (a.getSize()[0] + b.getSize()[0]) / 2 + self._sizeOffsets[0] + self._headOffsets[0]:
-			if abs(posDiff[1]) < (a.getSize()[1] + b.getSize()[1]) / 2 + self._sizeOffsets[1] + self._headOffsets[1]:
-				return True
-		return False
+		if abs(posDiff[0]) >= (a.getSize()[0] + b.getSize()[0]) / 2 + self._sizeOffsets[0] + self._headOffsets[0]:
+			return False
+		if abs(posDiff[1]) >= (a.getSize()[1] + b.getSize()[1]) / 2 + self._sizeOffsets[1] + self._headOffsets[1]:
+			return False
+		footprintA = a.getFootprint(self._sizeOffsets + self._headOffsets)
+		footprintB = b.getFootprint()
+		if len(footprintA) < 1 or len(footprintB) < 1:
+			return True
+		return convexHull.hullsOverlap2D(footprintA + a.getPosition()[0:2], footprintB + b.getPosition()[0:2])
 
 	def checkPlatform(self, obj):
 		p = obj.getPosition()
@@ -316,36 +368,50 @@ class Scene(object):
 		if p[1] + s[1] > self._machineSize[1] / 2:
 			return False
 
-		#Do clip Check for UM2.
+		#Do clip Check for UM2. The bounding box is exact for the sides of the platform, but not for the clips in the corners,
+		# so when the bounding box touches a clip the footprint is checked against it.
 		machine = profile.getMachineSetting('machine_type')
 		if(machine == "ultimaker2"):
+			w = self._machineSize[0] / 2
+			h = self._machineSize[1] / 2
+			clipList = []
 			#lowerRight clip check
-			if p[0] - s[0] < -self._machineSize[0] / 2 + 25 and p[1] - s[1] < -self._machineSize[1]/2 + 10:
-				return False
+			if p[0] - s[0] < -w + 25 and p[1] - s[1] < -h + 10:
+				clipList.append((-w, -h, -w + 25, -h + 10))
 			#UpperRight
-			if p[0] - s[0] < -self._machineSize[0] / 2 + 25 and p[1] + s[1] > self._machineSize[1]/2 - 10:
-				return False
+			if p[0] - s[0] < -w + 25 and p[1] + s[1] > h - 10:
+				clipList.append((-w, h - 10, -w + 25, h))
 			#LowerLeft
-			if p[0] + s[0] > self._machineSize[0] / 2 - 25 and p[1] - s[1] < -self._machineSize[1]/2 + 10:
-				return False
+			if p[0] + s[0] > w - 25 and p[1] - s[1] < -h + 10:
+				clipList.append((w - 25, -h, w, -h + 10))
 			#UpperLeft
-			if p[0] + s[0] > self._machineSize[0] / 2 - 25 and p[1] + s[1] > self._machineSize[1]/2 - 10:
-				return False
+			if p[0] + s[0] > w - 25 and p[1] + s[1] > h - 10:
+				clipList.append((w - 25, h - 10, w, h))
+			if len(clipList) > 0:
+				footprint = obj.getFootprint(self._sizeOffsets)
+				if len(footprint) < 1:
+					return False
+				footprint = footprint + p[0:2]
+				for x0, y0, x1, y1 in clipList:
+					if convexHull.hullsOverlap2D(footprint, numpy.array([[x0, y0], [x1, y0], [x1, y1], [x0, y1]], numpy.float64)):
+						return False
 		return True
 
 	def _findFreePositionFor(self, obj):
+		#Try 8 directions around every object, at the distance where the footprints just do not hit in that direction.
+		# This distance follows from the extremes of both footprints in that direction.
 		posList = []
+		directions = numpy.array([[1,1],[0,1],[-1,1],[1,0],[-1,0],[1,-1],[0,-1],[-1,-1]], numpy.float64)
+		directions /= numpy.sqrt(numpy.sum(directions * directions, 1)).reshape((8, 1))
+		footprint = obj.getFootprint()
 		for a in self._objectList:
-			p = a.getPosition()
-			s = (a.getSize()[0:2] + obj.getSize()[0:2]) / 2 + self._sizeOffsets + self._headOffsets
-			posList.append(p + s * ( 1.0, 1.0))
-			posList.append(p + s * ( 0.0, 1.0))
-			posList.append(p + s * (-1.0, 1.0))
-			posList.append(p + s * ( 1.0, 0.0))
-			posList.append(p + s * (-1.0, 0.0))
-			posList.append(p + s * ( 1.0,-1.0))
-			posList.append(p + s * ( 0.0,-1.0))
-			posList.append(p + s * (-1.0,-1.0))
+			p = a.getPosition()[0:2]
+			grown = a.getFootprint(self._sizeOffsets + self._headOffsets)
+			if len(grown) < 1 or len(footprint) < 1:
+				continue
+			distances = numpy.max(numpy.dot(grown, directions.T), 0) + numpy.max(numpy.dot(footprint, -directions.T), 0) + 0.1
+			for n in xrange(0, 8):
+				posList.append(p + directions[n] * distances[n])
 
 		best = None
 		bestDist = None
@@ -339,6 +339,8 @@ setting('youmagine_token', '', str, 'preference', 'hidden')
 setting('filament_physical_density', '1240', float, 'preference', 'hidden').setRange(500.0, 3000.0).setLabel(_("Density (kg/m3)"), _("Weight of the filament per m3. Around 1240 for PLA. And around 1040 for ABS. This value is used to estimate the weight if the filament used for the print."))
 setting('language', 'English', str, 'preference', 'hidden').setLabel(_('Language'), _('Change the language in which Cura runs. Switching language requires a restart of Cura'))
 setting('active_machine', '0', int, 'preference', 'hidden')
+setting('mesh_cache_size', '512', float, 'preference', 'hidden').setRange(0).setLabel(_("Mesh cache size (MB)"), _("Loaded models are cached on disk so they load faster the next time. Set at 0 to disable the cache."))
+setting('auto_orient', 'False', bool, 'preference', 'hidden').setLabel(_("Auto orient on load"), _("Rotate loaded models to the orientation with the least overhang and the most contact with the bed."))
 
 setting('model_colour', '#FFC924', str, 'preference', 'hidden').setLabel(_('Model colour'))
 setting('model_colour2', '#CB3030', str, 'preference', 'hidden').setLabel(_('Model colour (2)'))
@@ -163,11 +163,15 @@ class Slicer(object):
 				for obj in scene.objects():
 					if scene.checkPlatform(obj):
 						for mesh in obj._meshList:
-							vertexes = (numpy.matrix(mesh.vertexes, copy = False) * numpy.matrix(obj._matrix, numpy.float32)).getA()
+							vertexes = mesh.getTransformedVertexes()
 							vertexes -= obj._drawOffset
 							vertexes += numpy.array([obj.getPosition()[0], obj.getPosition()[1], 0.0])
 							f.write(vertexes.tostring())
-							hash.update(mesh.vertexes.tostring())
+							if mesh.isIndexed():
+								hash.update(mesh.indexedVertexes.tostring())
+								hash.update(mesh.indexes.tostring())
+							else:
+								hash.update(mesh.vertexes.tostring())
 
 				commandList += ['#']
 				self._objCount = 1